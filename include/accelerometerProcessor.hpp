@@ -1,16 +1,20 @@
-#pragma once
-
-#include <BleKeyboard.h>
-#include <MPU6050.h>
-#include "preferencesManager.hpp"
-#include "arcadeButtonProcessor.hpp"
-
-#define ACCELEROMETER_SDA  4     // SDA
-#define ACCELEROMETER_SCL 33     // SCL
-
-const unsigned long NUDGE_PRESS_TIME = 50;
-const unsigned long NUDGE_COOLDOWN = 100;  // Increased from 100ms to prevent spam
-const int NUDGE_THRESHOLD = 8000;  // Adjust this for sensitivity
-
-void tryToStartAccelerometer();
-void checkNudge(BleKeyboard* keyboard);
\ No newline at end of file
+#pragma once
+
+#include "hidOutput.hpp"
+#include <MPU6050.h>
+#include "preferencesManager.hpp"
+#include "arcadeButtonProcessor.hpp"
+#include "boardPins.hpp"         // ACCELEROMETER_SDA, ACCELEROMETER_SCL
+
+// Defaults; the live values come from the settings store
+const unsigned long NUDGE_PRESS_TIME = 50;
+const unsigned long NUDGE_COOLDOWN = 100;  // Increased from 100ms to prevent spam
+const int NUDGE_THRESHOLD = 8000;  // Adjust this for sensitivity
+
+#define CALIBRATION_SAMPLES       10
+#define CALIBRATION_INTERVAL_MS   10
+
+bool tryToStartAccelerometer();
+bool serviceAccelerometerCalibration();
+void checkNudge();
+void resetNudge();
\ No newline at end of file
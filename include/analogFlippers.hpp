@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Arduino.h>
+#include "arcadeButtonProcessor.hpp"
+
+// Hall-effect flippers report how far the button is pushed (0 at rest to ANALOG_FULL_SCALE
+// bottomed out). Past the press point the flipper bit reads as pressed, and it only releases once
+// the position falls the hysteresis below that, so a sensor hovering at the edge can't chatter
+const int32_t FLIPPER_PRESS_POINT = 400;   // default for SETTING_FLIPPER_PRESS
+const int32_t FLIPPER_HYSTERESIS = 60;     // default for SETTING_FLIPPER_HYSTERESIS
+
+#ifdef ANALOG_FLIPPERS
+// Input task, after the analog inputs are filtered: updates each flipper's pressed state and, when
+// the flipper is mapped to a gamepad button, its trigger axis
+void serviceFlippers();
+// Returns raw with the flipper bits replaced by the press-point state (0 = pressed, like the chain)
+InputWord applyAnalogFlippers(InputWord raw);
+void printFlipperStatus();
+#else
+inline InputWord applyAnalogFlippers(InputWord raw) { return raw; }
+#endif
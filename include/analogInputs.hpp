@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Uncomment for a potentiometer or IR distance sensor plunger (see analogPlunger.hpp)
+//#define ANALOG_PLUNGER
+// Uncomment for hall-effect flipper buttons in place of the flipper switches (see analogFlippers.hpp)
+//#define ANALOG_FLIPPERS
+
+#if defined(ANALOG_PLUNGER) || defined(ANALOG_FLIPPERS)
+#define ANALOG_INPUTS
+#endif
+
+// The DMA setup and the channels below are the classic ESP32's (the S3 has other ADC1 pins and
+// another sample format)
+#if defined(ANALOG_INPUTS) && defined(CONFIG_IDF_TARGET_ESP32S3)
+#error "Analog inputs are only ported to the classic ESP32"
+#endif
+
+// The ADC converts continuously into a DMA buffer and the input task takes whatever arrived since
+// its last tick, so no scan ever waits on a conversion. The classic ESP32 only does this on ADC1
+// (GPIO32-39) and not below 20 kHz; the enabled inputs share that rate, so each tick averages
+// somewhere between 6 and 20 samples per input before the fixed point filter
+#define ANALOG_SAMPLE_HZ         20000
+#define ANALOG_READ_BYTES        256
+#define ANALOG_FILTER_SHIFT      2       // y += (x - y) / 4 each tick, in 1/16 ADC counts
+#define ANALOG_FULL_SCALE        1023    // calibrated position range
+
+#define ANALOG_PLUNGER_CHANNEL   4       // ADC1_CH4 = GPIO32, the only ADC1 pin the QT Py breaks out
+// The flippers need a board that brings out more of ADC1. Not GPIO33 (ADC1_CH5): that is ACCELEROMETER_SCL
+#define ANALOG_LFLIPPER_CHANNEL  7       // ADC1_CH7 = GPIO35
+#define ANALOG_RFLIPPER_CHANNEL  6       // ADC1_CH6 = GPIO34
+
+enum ANALOG_INPUT {
+	ANALOG_IN_PLUNGER = 0,
+	ANALOG_IN_LFLIPPER,
+	ANALOG_IN_RFLIPPER,
+	NUM_ANALOG_INPUTS
+};
+
+// Raw readings at the two ends of travel; full may be below rest
+struct AnalogCalibration {
+	uint16_t rest;
+	uint16_t full;
+};
+
+#ifdef ANALOG_INPUTS
+// Reads the saved calibration, so call it after loadSettings()
+void analogInputsBegin();
+// Input task, once per tick before the buttons are scanned: drains the DMA buffer, filters every
+// input and runs the plunger and flippers
+void processAnalogInputs();
+// 0 at rest to ANALOG_FULL_SCALE at full travel
+uint16_t analogPosition(uint8_t input);
+#else
+inline void analogInputsBegin() {}
+inline void processAnalogInputs() {}
+#endif
+
+void analogCommand(const char* args);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Positions are 0 (rest) to ANALOG_FULL_SCALE (fully pulled). A pull past the arm point followed
+// by a fall faster than the release speed is a launch; easing the plunger back by hand is not
+#define PLUNGER_ARM_POSITION     100
+#define PLUNGER_REST_POSITION    30
+#define PLUNGER_RELEASE_SPEED    8       // position units per ms
+#define PLUNGER_SPEED_WINDOW     4       // ticks the speed is measured over
+#define PLUNGER_FULL_PULL_MS     1000    // key hold for a full-strength launch; Visual Pinball pulls back over about a second
+#define PLUNGER_MIN_PRESS_MS     20
+
+enum PLUNGER_MODE {
+	PLUNGER_OFF = 0,
+	PLUNGER_KEYS,            // each launch holds the plunger key for a time matching its strength
+	PLUNGER_AXIS             // the position goes out as the gamepad Z axis; the game sees the release itself.
+	                         // Keyboard profiles have no gamepad, so they fall back to PLUNGER_KEYS
+};
+
+const int32_t PLUNGER_MODE_DEFAULT = PLUNGER_KEYS;   // default for SETTING_PLUNGER_MODE
+
+// Input task, after the analog inputs are filtered
+void servicePlunger(unsigned long now);
+void printPlungerStatus();
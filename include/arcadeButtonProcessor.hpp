@@ -1,77 +1,92 @@
-#pragma once
-
-#include <BleKeyboard.h>
-#include <BleGamepad.h>
-#include <Arduino.h>
-#include "preferencesManager.hpp"
-#include "solenoidProcessor.hpp"
-
-extern int currentGameMode;
-
-// 74HC165 Shift Register (SR) Pins
-#define SR_DATA           7    // QH - Serial data out
-#define SR_CLK            14   // CLK - Clock pin
-#define SR_LOAD           12   // SH/LD - Latch pin
-
-// Button mappings from shift register (active LOW)
-#define BTN_BIT_RMAGNASAVE    0  // A - Right MagnaSave
-#define BTN_BIT_RFLIPPER      1  // B - Right Flipper
-#define BTN_BIT_PLUNGER       2  // C - Plunger
-#define BTN_BIT_START         3  // D - Start button
-#define BTN_BIT_SPECIAL       4  // E - Special
-#define BTN_BIT_NOTUSED       5  // F - nothing assigned
-#define BTN_BIT_LMAGNASAVE    6  // G - Left MagnaSave
-#define BTN_BIT_LFLIPPER      7  // H - Left Flipper
-
-// Quest Pinball FX VR key mappings
-#define KEY_RFLIPPER_QPVR      '6'
-#define KEY_LFLIPPER_QPVR      'u'
-#define KEY_PLUNGER_QPVR       '8'
-#define KEY_SPECIAL_QPVR       '5'
-#define KEY_RMAGNASAVE_QPVR    'd'
-#define KEY_LMAGNASAVE_QPVR    'f'
-#define KEY_NUDGE_UP_QPVR      'a'
-
-// PC Visual Pinball key mappings
-#define KEY_RFLIPPER_PCVP      KEY_RIGHT_SHIFT
-#define KEY_LFLIPPER_PCVP      KEY_LEFT_SHIFT
-#define KEY_PLUNGER_PCVP       KEY_RETURN
-#define KEY_SPECIAL_PCVP       '5'   // Coin
-#define KEY_START_PCVP         '1'
-#define KEY_RMAGNASAVE_PCVP    KEY_RIGHT_CTRL
-#define KEY_LMAGNASAVE_PCVP    KEY_LEFT_CTRL
-
-struct ButtonMapping {
-		uint8_t bit;
-		char key;
-};
-
-const ButtonMapping questButtonMap[] = {
-		{BTN_BIT_RMAGNASAVE, KEY_RMAGNASAVE_QPVR},
-		{BTN_BIT_RFLIPPER,   KEY_RFLIPPER_QPVR},
-		{BTN_BIT_PLUNGER,    KEY_PLUNGER_QPVR},
-		{BTN_BIT_SPECIAL,    KEY_SPECIAL_QPVR},
-		{BTN_BIT_LMAGNASAVE, KEY_LMAGNASAVE_QPVR},
-		{BTN_BIT_LFLIPPER,   KEY_LFLIPPER_QPVR},
-		{BTN_BIT_START,      KEY_NUDGE_UP_QPVR}
-};
-
-const ButtonMapping pcButtonMap[] = {
-		{BTN_BIT_RMAGNASAVE, KEY_RMAGNASAVE_PCVP},
-		{BTN_BIT_RFLIPPER,   KEY_RFLIPPER_PCVP},
-		{BTN_BIT_PLUNGER,    KEY_PLUNGER_PCVP},
-		{BTN_BIT_SPECIAL,    KEY_SPECIAL_PCVP},
-		{BTN_BIT_START,      KEY_START_PCVP},
-		{BTN_BIT_LMAGNASAVE, KEY_LMAGNASAVE_PCVP},
-		{BTN_BIT_LFLIPPER,   KEY_LFLIPPER_PCVP}
-};
-
-const uint8_t QUEST_NUM_BUTTONS = sizeof(questButtonMap) / sizeof(ButtonMapping);
-const uint8_t PC_NUM_BUTTONS = sizeof(pcButtonMap) / sizeof(ButtonMapping);
-
-const unsigned long DEBOUNCE_MS = 5;  // try 5–10ms
-
-void processKeyboardButtons(BleKeyboard* keyboard);
-
-// Uncomment to enable Serial debug logs for button edges
+#pragma once
+
+#include "hidOutput.hpp"
+#include <Arduino.h>
+#include "preferencesManager.hpp"
+#include "solenoidProcessor.hpp"
+#include "switchMatrix.hpp"
+#include "boardPins.hpp"
+
+extern int currentGameMode;
+
+// 74HC165 Shift Register (SR) pins: SR_DATA, SR_CLK, SR_LOAD in boardPins.hpp
+
+// Button mappings from shift register (active LOW)
+#define BTN_BIT_RMAGNASAVE    0  // A - Right MagnaSave
+#define BTN_BIT_RFLIPPER      1  // B - Right Flipper
+#define BTN_BIT_PLUNGER       2  // C - Plunger
+#define BTN_BIT_START         3  // D - Start button
+#define BTN_BIT_SPECIAL       4  // E - Special
+#define BTN_BIT_NOTUSED       5  // F - nothing assigned
+#define BTN_BIT_LMAGNASAVE    6  // G - Left MagnaSave
+#define BTN_BIT_LFLIPPER      7  // H - Left Flipper
+
+// With SWITCH_MATRIX the buttons above are row 0; row 1 is the coin door and service panel
+#define BTN_BIT_COIN1         8
+#define BTN_BIT_COIN2         9
+#define BTN_BIT_COIN_DOOR     10
+#define BTN_BIT_SERVICE_CANCEL 11
+#define BTN_BIT_SERVICE_DOWN  12
+#define BTN_BIT_SERVICE_UP    13
+#define BTN_BIT_SERVICE_ENTER 14
+#define BTN_BIT_EXIT          15
+
+struct ButtonMapping {
+		uint8_t bit;
+		char key;
+};
+
+#ifdef SWITCH_MATRIX
+#define NUM_INPUT_BITS         64
+typedef uint64_t InputWord;           // bit = row * 8 + column
+#else
+#define NUM_INPUT_BITS         8
+typedef uint8_t InputWord;
+#endif
+
+#define INPUT_BIT(bit)         ((InputWord)1 << (bit))
+
+// The 8 bit build keeps the cheaper 32 bit count
+inline uint8_t lowestInputBit(InputWord word){
+	return (sizeof(InputWord) > 4) ? __builtin_ctzll(word) : __builtin_ctz(word);
+}
+#define MACRO_MAX_KEYS         3
+
+// What a shift register bit does when pressed; each game profile carries the default map
+enum ACTION_TYPE {
+	ACTION_NONE = 0,
+	ACTION_KEY,              // codes[0] is a key
+	ACTION_GAMEPAD_BUTTON,   // codes[0] is a gamepad button number
+	ACTION_MACRO,            // up to MACRO_MAX_KEYS keys pressed and released together
+	ACTION_HOST_SWITCH,      // route reports to the next connected BLE host
+	NUM_ACTION_TYPES
+};
+
+struct ButtonAction {
+	uint8_t type;
+	uint8_t codes[MACRO_MAX_KEYS];
+};
+
+// Indexed by bit, so an edge resolves to its action with a single load
+extern ButtonAction activeButtonMap[NUM_INPUT_BITS];
+
+const unsigned long DEBOUNCE_MS = 5;  // default, tunable via SETTING_DEBOUNCE_MS; try 5–10ms
+
+// Reading the map from flash (stage) is split from switching to it (install, input task only) so
+// a mode change never waits on flash between two scans; loadButtonMap does both, for setup()
+void stageButtonMap(int mode);
+void installButtonMap();
+void loadButtonMap(int mode);
+void saveButtonMap(int mode);
+void mapCommand(const char* args);
+void resetButtonStates();
+uint8_t readShiftRegister();
+void processKeyboardButtons();
+// Debounce and edge handling for one raw scan; split out so it can be benchmarked on its own
+void updateButtonStates(InputWord raw, unsigned long now);
+// An edge seen outside the scan (a direct GPIO interrupt): restarts the bit's debounce timer from
+// when the edge happened rather than when the next scan notices it
+void noteInputEdge(uint8_t bit, uint8_t level, unsigned long when);
+
+// Uncomment to enable Serial debug logs for button edges
 //#define BUTTON_DEBUG
\ No newline at end of file
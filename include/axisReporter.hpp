@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Analog inputs have a new value every input tick, far more often than any link can carry or a game
+// can use. An axis goes out when it has moved by at least the epsilon, or when a smaller change has
+// waited the refresh time; either way no more than once per report interval of the backend (the BLE
+// connection interval, the USB polling interval), and all changed axes go out together
+const int32_t AXIS_EPSILON = 2;         // default for SETTING_AXIS_EPSILON, in -127..127 units
+const int32_t AXIS_REFRESH_MS = 50;     // default for SETTING_AXIS_REFRESH_MS
+
+// Input task: the latest value for an axis; only axes given a value since the last reset are sent
+void reportAxis(uint8_t axis, int8_t value);
+// Input task, once per tick after every reportAxis()
+void flushAxisReports();
+// After a release-all the host has every axis at 0; forget what was sent so nothing is assumed
+void resetAxisReports();
+void printAxisStatus();
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Arduino.h>
+#include "hidOutput.hpp"
+
+#ifdef OUTPUT_BACKEND_BLE
+
+#include <BLEDevice.h>
+#include <esp_gap_ble_api.h>
+#include "bleHidKeyboard.hpp"
+
+// High duty cycle directed advertising is capped at 1.28 s by the Bluetooth spec;
+// after that we fall back to normal undirected advertising
+#define DIRECTED_ADV_WINDOW_MS    1280
+#define DIRECTED_ADV_INTERVAL     0x20   // 20 ms in 0.625 ms units; ignored by the controller for high duty
+
+// Concurrent centrals (e.g. Quest and PC); the Arduino core allows 4 ACL links (CONFIG_BT_ACL_CONNECTIONS)
+#define MAX_BLE_HOSTS             2
+
+// Notifications handed to the stack and not yet confirmed with ESP_GATTS_CONF_EVT. Anything beyond
+// this waits as a single latest-state report, so a congested link never builds a backlog of stale
+// states; a confirmation that never comes is written off after the timeout (not counted while the
+// link is congested, when the stack holds them back)
+#define MAX_REPORTS_IN_FLIGHT     2
+#define REPORT_CONF_TIMEOUT_MS    100
+
+// The HID device's input reports; each host has a latest-state slot for every one of them
+enum BLE_REPORT {
+	BLE_REPORT_KEYBOARD = 0,
+	BLE_REPORT_GAMEPAD,
+	NUM_BLE_REPORTS
+};
+#define BLE_REPORT_BIT(report)    (1 << (report))
+#define ALL_BLE_REPORTS           (BLE_REPORT_BIT(NUM_BLE_REPORTS) - 1)
+
+// Last host that bonded while a profile was active, stored as "host<mode>"
+struct BondedHost {
+	uint8_t address[6];
+	uint8_t addressType;
+	uint8_t valid;
+};
+
+// One slot per connected central. Each holds only the latest state for its host, sent once the
+// stack has a buffer free on that link; only the active host is fed new ones
+struct BleHost {
+	uint8_t address[6];
+	uint8_t addressType;
+	bool inUse;
+	bool fresh;              // connected since loop() last looked
+	bool bonded;             // pairing/encryption finished on this link
+	bool congested;
+	bool sending;            // one task at a time sends, so states can't go out of order
+	uint8_t pending;         // BLE_REPORT_BITs of the reports changed since they last went out
+	uint8_t inFlight;
+	uint16_t connId;
+	uint16_t connInterval;   // 1.25 ms units, from the connect and parameter update events
+	NkroReport report;
+	PadReport padReport;
+	uint32_t pendingSince;   // micros() when the oldest waiting state was first set
+	uint32_t confWaitSince;  // micros() of the last send or confirmation with notifications in flight
+	uint32_t sent;
+	uint32_t merged;         // states replaced before they went out
+	uint32_t dropped;        // notifications that failed or were never confirmed; the latest state is resent.
+	                         // Congestion is not a drop: the state just waits
+	uint32_t maxWaitUs;      // longest a state waited for a free buffer
+};
+
+enum RECONNECT_STATE {
+	RECONNECT_IDLE = 0,      // connected, or advertising undirected
+	RECONNECT_PENDING,       // link just dropped (or we just booted)
+	RECONNECT_DIRECTED       // directed advertising to the profile's bonded host
+};
+
+void bleConnectionBegin();
+void serviceBleConnection();
+
+// Report routing, used by BleHidKeyboard
+void bleSetReportHandles(uint16_t keyboardHandle, uint16_t gamepadHandle);
+void bleQueueReport(const NkroReport& report);
+void bleQueuePadReport(const PadReport& report);
+bool bleHostConnected();
+// The active host's connection interval; 0 with no host
+uint32_t bleReportIntervalUs();
+
+// Host switching; -1 picks the next connected host
+bool switchActiveHost(int index);
+void bleProfileChanged();
+
+#else
+inline void serviceBleConnection() {}
+inline bool switchActiveHost(int) { return false; }
+inline void bleProfileChanged() {}
+#endif
+
+void bleCommand(const char* args);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Arduino.h>
+#include <BleKeyboard.h>     // KEY_* codes; the BleKeyboard class itself is not used
+#include <BLEDevice.h>
+#include <BLEHIDDevice.h>    // BleKeyboard.h includes it too, appearance macros and all
+#include "hidOutput.hpp"      // NUM_PAD_AXES
+
+#define KEYBOARD_REPORT_ID     0x01
+#define GAMEPAD_REPORT_ID      0x02
+#define NUM_PAD_BUTTONS        32
+
+// One bit per usage instead of six key slots, so every mapped input can be held at once. Key codes
+// 136-255 are usages 0-119 and ASCII stays below 0x39, so 128 bits cover every code we can be given
+#define NKRO_USAGE_COUNT       128
+#define NKRO_KEY_BYTES         (NKRO_USAGE_COUNT / 8)
+
+struct NkroReport {
+	uint8_t modifiers;
+	uint8_t keys[NKRO_KEY_BYTES];
+};
+
+// Gamepad buttons 1-32 and the PAD_AXIS axes, same layout as the USB gamepad minus the unused axes
+struct PadReport {
+	uint32_t buttons;
+	int8_t axes[NUM_PAD_AXES];
+} __attribute__((packed));
+
+// Where a key code lands in the report; resolved once for all 256 codes, so a press or release is
+// a single OR or AND however many keys are down
+struct KeyMask {
+	uint8_t byte;            // index into NkroReport::keys
+	uint8_t bit;             // 0 for a bare modifier
+	uint8_t modifiers;
+};
+
+// HID keyboard plus gamepad on the Arduino BLE stack, with the same press/release API as BleKeyboard.
+// BleKeyboard notifies every connected central; this one builds the reports itself and hands
+// them to bleConnectionManager, which sends them to the active host only
+class BleHidKeyboard {
+public:
+	BleHidKeyboard(const char* deviceName, const char* manufacturer, uint8_t batteryLevel);
+	void begin();
+	size_t press(uint8_t k);
+	size_t release(uint8_t k);
+	void releaseAll();
+	void padPress(uint8_t button);
+	void padRelease(uint8_t button);
+	void setAxes(const int8_t values[NUM_PAD_AXES]);
+	bool isConnected();
+	void sendReport(NkroReport* report);
+
+private:
+	const char* deviceName;
+	const char* manufacturer;
+	uint8_t batteryLevel;
+	NkroReport keyReport;
+	uint8_t modifierCounts[8];   // held keys that need each modifier bit
+	PadReport padReport;
+	KeyMask keyMasks[256];
+	BLEHIDDevice* hid;
+	BLECharacteristic* inputKeyboard;
+	BLECharacteristic* outputKeyboard;
+	BLECharacteristic* inputGamepad;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Every GPIO the controller drives or reads, one block per board. The feature headers take their
+// pins from here, so porting to another board means adding a block and nothing else.
+// Pins a board doesn't break out are shared with options that can't be built together; the
+// #error checks in arcadeButtonProcessor.cpp catch the combinations that would clash
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+
+// Adafruit QT Py ESP32-S3 (no PSRAM, so GPIO35-37 are free and broken out as MOSI/SCK/MISO)
+#define SR_DATA                 37     // MISO pad: QH - Serial data out
+#define SR_CLK                  36     // SCK pad: CLK - Clock pin
+#define SR_LOAD                 35     // MOSI pad: SH/LD - Latch pin
+
+#define LEFT_SOLENOID           18     // A0
+#define RIGHT_SOLENOID          17     // A1
+
+#define PIN_LED_STRIP           5      // TX
+
+#define ACCELEROMETER_SDA       7      // SDA
+#define ACCELEROMETER_SCL       6      // SCL
+
+// STEMMA QT connector, plus RX for the interrupt
+#define EXPANDER_SDA            41
+#define EXPANDER_SCL            40
+#define EXPANDER_INT            16     // RX
+
+#define DIRECT_PIN_LFLIPPER     9      // A2
+#define DIRECT_PIN_RFLIPPER     8      // A3
+#define DIRECT_PIN_LMAGNASAVE   -1
+#define DIRECT_PIN_RMAGNASAVE   -1
+
+// Row selects have to be below GPIO32; the only free ones left are RX and the direct flipper pads
+#define MATRIX_ROW_A0           16     // RX
+#define MATRIX_ROW_A1           9      // A2
+#define MATRIX_ROW_A2           8      // A3
+#define BOARD_MATRIX_SHARES_DIRECT_PINS
+
+// The core's variant already names the onboard NeoPixel pins
+#ifndef PIN_NEOPIXEL
+#define PIN_NEOPIXEL            39
+#endif
+#ifndef NEOPIXEL_POWER
+#define NEOPIXEL_POWER          38
+#endif
+
+#else
+
+// Adafruit QT Py ESP32 Pico
+#define SR_DATA                 7      // QH - Serial data out
+#define SR_CLK                  14     // CLK - Clock pin
+#define SR_LOAD                 12     // SH/LD - Latch pin
+
+#define LEFT_SOLENOID           26
+#define RIGHT_SOLENOID          25
+
+#define PIN_LED_STRIP           13
+
+#define ACCELEROMETER_SDA       4
+#define ACCELEROMETER_SCL       33
+
+// Second I2C bus on the STEMMA QT connector, so the input task never waits behind the accelerometer
+#define EXPANDER_SDA            22
+#define EXPANDER_SCL            19
+#define EXPANDER_INT            15     // INTA, active low
+
+// Switch to ground, internal pull-up; -1 leaves that button on the shift register
+#define DIRECT_PIN_LFLIPPER     27
+#define DIRECT_PIN_RFLIPPER     32
+#define DIRECT_PIN_LMAGNASAVE   -1
+#define DIRECT_PIN_RMAGNASAVE   -1
+
+// The same STEMMA QT pins as the expander, which it replaces
+#define MATRIX_ROW_A0           22
+#define MATRIX_ROW_A1           19
+#define MATRIX_ROW_A2           15
+
+// Onboard NeoPixel; single LED
+#ifndef PIN_NEOPIXEL
+#define PIN_NEOPIXEL            5
+#endif
+#ifndef NEOPIXEL_POWER
+#define NEOPIXEL_POWER          8
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+#include "arcadeButtonProcessor.hpp"
+#include "boardPins.hpp"
+
+// Uncomment to wire the flippers (and optionally the MagnaSaves) straight to GPIOs instead of the
+// shift register. Each pin interrupts on both edges; the rest of the buttons stay on the chain
+//#define DIRECT_INPUTS
+
+// Switch to ground, internal pull-up, so the level reads like a shift register bit (1 = released).
+// DIRECT_PIN_* in boardPins.hpp; -1 leaves that button on the shift register
+
+#define DIRECT_EDGE_QUEUE_LENGTH 32
+
+// Uncomment (with DIRECT_INPUTS) to count the direct pins' edges in the pulse counter units instead
+// of taking an interrupt per edge. The counters run on their own, so no edge is lost however busy
+// the CPU is, and every switch gets a bounce count. The PCNT glitch filter tops out at 1023 APB
+// cycles (12.8 us), which rejects solenoid noise spikes but not contact bounce; debounce still
+// happens in updateButtonStates()
+//#define DIRECT_INPUTS_PCNT
+
+#define PCNT_FILTER_TICKS        1023     // APB cycles at 80 MHz
+#define PCNT_COUNT_LIMIT         30000    // the counter goes back to 0 here
+
+struct InputEdge {
+	uint8_t bit;
+	uint8_t level;
+	uint32_t timestamp;      // micros() in the ISR
+};
+
+#ifdef DIRECT_INPUTS
+// Call from the core the input task runs on, so the interrupts are serviced there
+void directInputsBegin();
+// Replays every edge captured since the last scan into the debounce timers and returns raw with
+// the direct bits replaced by their current level
+InputWord applyDirectInputs(InputWord raw);
+#else
+inline void directInputsBegin() {}
+inline InputWord applyDirectInputs(InputWord raw) { return raw; }
+#endif
+
+void directCommand(const char* args);
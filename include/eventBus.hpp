@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// Bounded lock-free queue, safe for any number of producers (tasks or ISRs) and one consumer.
+// Each cell carries a sequence number, so a producer only ever races other producers on one
+// compare-and-swap and never waits for the consumer; a full queue drops the event and counts it
+template <typename T, uint16_t CAPACITY>
+class EventQueue {
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0, "EventQueue capacity must be a power of two");
+
+public:
+	EventQueue() : enqueuePos(0), dequeuePos(0), dropped(0) {
+		for (uint16_t i = 0; i < CAPACITY; i++) {
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// In IRAM: interrupt handlers push too, and may run while the flash cache is off
+	bool IRAM_ATTR push(const T& item){
+		Cell* cell;
+		uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+		while (true) {
+			cell = &cells[pos & (CAPACITY - 1)];
+			int32_t diff = (int32_t)(cell->sequence.load(std::memory_order_acquire) - pos);
+			if (diff == 0) {
+				if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			} else if (diff < 0) {
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			} else {
+				pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		cell->data = item;
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side only
+	bool pop(T& item){
+		Cell& cell = cells[dequeuePos & (CAPACITY - 1)];
+		if ((int32_t)(cell.sequence.load(std::memory_order_acquire) - (dequeuePos + 1)) < 0) return false;
+		item = cell.data;
+		cell.sequence.store(dequeuePos + CAPACITY, std::memory_order_release);
+		dequeuePos++;
+		return true;
+	}
+
+	uint32_t droppedCount() const {
+		return dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct Cell {
+		std::atomic<uint32_t> sequence;
+		T data;
+	};
+	Cell cells[CAPACITY];
+	std::atomic<uint32_t> enqueuePos;
+	uint32_t dequeuePos;
+	std::atomic<uint32_t> dropped;
+};
+
+#define EVENT_QUEUE_LENGTH       32
+#define MAX_EVENT_SUBSCRIBERS    6
+
+enum EVENT_TYPE {
+	EVENT_BUTTON_EDGE = 0,   // code = input bit, value = 1 pressed / 0 released
+	EVENT_NUDGE,             // code = nudge key (0 when unmapped), value = 1 started / 0 ended
+	EVENT_MODE_CHANGE,       // code = new game mode
+	EVENT_CONNECTION,        // value = 1 when the output came up, 0 when it went away
+	NUM_EVENT_TYPES
+};
+
+#define EVENT_MASK(type)   (1 << (type))
+
+struct Event {
+	uint8_t type;
+	uint8_t code;
+	uint8_t value;
+	uint32_t timestamp;      // micros()
+};
+
+typedef EventQueue<Event, EVENT_QUEUE_LENGTH> EventSubscriber;
+
+// Each consumer owns one queue and receives the event types in its mask. Subscribe once, from
+// the task that will pop; publishing is lock-free and safe from any task or ISR
+EventSubscriber* subscribeEvents(const char* name, uint8_t typeMask);
+void publishEvent(uint8_t type, uint8_t code, uint8_t value);
+void busCommand(const char* args);
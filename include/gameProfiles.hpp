@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Arduino.h>
+#include "arcadeButtonProcessor.hpp"
+
+// Quest Pinball FX VR key mappings
+#define KEY_RFLIPPER_QPVR      '6'
+#define KEY_LFLIPPER_QPVR      'u'
+#define KEY_PLUNGER_QPVR       '8'
+#define KEY_SPECIAL_QPVR       '5'
+#define KEY_RMAGNASAVE_QPVR    'd'
+#define KEY_LMAGNASAVE_QPVR    'f'
+#define KEY_NUDGE_UP_QPVR      'a'
+
+// PC Visual Pinball key mappings
+#define KEY_RFLIPPER_PCVP      KEY_RIGHT_SHIFT
+#define KEY_LFLIPPER_PCVP      KEY_LEFT_SHIFT
+#define KEY_PLUNGER_PCVP       KEY_RETURN
+#define KEY_SPECIAL_PCVP       '5'   // Coin
+#define KEY_START_PCVP         '1'
+#define KEY_RMAGNASAVE_PCVP    KEY_RIGHT_CTRL
+#define KEY_LMAGNASAVE_PCVP    KEY_LEFT_CTRL
+#define KEY_NUDGE_LEFT_PCVP    'z'
+#define KEY_NUDGE_RIGHT_PCVP   '/'
+#define KEY_NUDGE_UP_PCVP      ' '
+
+// Layout shared by Pinball FX (PC), Zaccaria, Future Pinball and MAME
+#define KEY_RFLIPPER_PC        KEY_RIGHT_SHIFT
+#define KEY_LFLIPPER_PC        KEY_LEFT_SHIFT
+#define KEY_PLUNGER_PC         KEY_RETURN
+#define KEY_START_PC           '1'
+#define KEY_COIN_PC            '5'
+#define KEY_RMAGNASAVE_PC      KEY_RIGHT_CTRL
+#define KEY_LMAGNASAVE_PC      KEY_LEFT_CTRL
+#define KEY_NUDGE_LEFT_PC      'z'
+#define KEY_NUDGE_RIGHT_PC     '/'
+#define KEY_NUDGE_UP_PC        ' '
+
+// Coin door and service panel, Visual Pinball's default keys
+#define KEY_COIN1_PC           '5'
+#define KEY_COIN2_PC           '4'
+#define KEY_COIN_DOOR_PC       KEY_END
+#define KEY_SERVICE_CANCEL_PC  '7'
+#define KEY_SERVICE_DOWN_PC    '8'
+#define KEY_SERVICE_UP_PC      '9'
+#define KEY_SERVICE_ENTER_PC   '0'
+#define KEY_EXIT_PC            KEY_ESC
+
+// What the game takes from us. Keyboard games ignore a gamepad, so "pad" actions and the plunger
+// and trigger axes are only for gamepad profiles, which take the keys as well.
+// Prefixed: BLEHIDDevice.h, reached through BleKeyboard.h, #defines HID_KEYBOARD and HID_GAMEPAD
+enum HID_TYPE {
+	HID_TYPE_KEYBOARD = 0,
+	HID_TYPE_GAMEPAD
+};
+
+// Keys pressed for a nudge along each direction; 0 leaves that direction unused
+struct NudgeKeys {
+	uint8_t left;
+	uint8_t right;
+	uint8_t forward;
+	bool sidewaysFirst;      // X over the threshold always nudges sideways; otherwise the larger axis wins
+};
+
+struct GameProfile {
+	const char* name;
+	const ButtonMapping* buttonMap;   // built-in map; a map saved with "map save" overrides it
+	uint8_t numButtons;
+	NudgeKeys nudge;
+	uint32_t ledColor;
+	uint8_t hidType;         // HID_TYPE
+};
+
+#ifdef SWITCH_MATRIX
+// Added to every profile's built-in map; only a matrix has the inputs for it
+extern const ButtonMapping coinDoorButtonMap[];
+extern const uint8_t NUM_COIN_DOOR_BUTTONS;
+#endif
+
+// Indexed by GAME_MODE
+extern const GameProfile gameProfiles[NUM_GAME_MODES];
+
+// Resolved once per mode change so the scan and nudge paths never branch on the mode
+extern const GameProfile* activeProfile;
+
+// For setup(), before the tasks run
+void selectGameProfile(int mode);
+// System task only; see gameProfiles.cpp
+void switchControllerMode(int mode);
+void modeCommand(const char* args);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Where key and gamepad reports go, chosen at build time:
+//   -DOUTPUT_BACKEND_USB   wired USB HID keyboard + gamepad via TinyUSB (ESP32-S2/S3 only)
+//   -DOUTPUT_BACKEND_FAKE  records every call in RAM, for host builds and tests
+// BLE (BleHidKeyboard) is the default
+#if !defined(OUTPUT_BACKEND_USB) && !defined(OUTPUT_BACKEND_FAKE)
+#define OUTPUT_BACKEND_BLE
+#endif
+
+// Each backend brings the Arduino key codes (KEY_LEFT_SHIFT, KEY_RETURN, ...) the profiles use
+#if defined(OUTPUT_BACKEND_BLE)
+#include <BleKeyboard.h>
+#elif defined(OUTPUT_BACKEND_USB)
+#include <USBHIDKeyboard.h>
+#else
+#define KEY_LEFT_CTRL     0x80
+#define KEY_LEFT_SHIFT    0x81
+#define KEY_LEFT_ALT      0x82
+#define KEY_LEFT_GUI      0x83
+#define KEY_RIGHT_CTRL    0x84
+#define KEY_RIGHT_SHIFT   0x85
+#define KEY_RIGHT_ALT     0x86
+#define KEY_RIGHT_GUI     0x87
+#define KEY_RETURN        0xB0
+#define KEY_ESC           0xB1
+#define KEY_BACKSPACE     0xB2
+#define KEY_TAB           0xB3
+#define KEY_RIGHT_ARROW   0xD7
+#define KEY_LEFT_ARROW    0xD8
+#define KEY_DOWN_ARROW    0xD9
+#define KEY_UP_ARROW      0xDA
+#define KEY_END           0xD5
+#endif
+
+void outputBegin();
+bool outputConnected();
+void outputPress(uint8_t key);
+void outputRelease(uint8_t key);
+void outputReleaseAll();
+// Gamepad buttons are numbered from 1; backends without a gamepad ignore them
+void outputGamepadPress(uint8_t button);
+void outputGamepadRelease(uint8_t button);
+
+enum PAD_AXIS {
+	PAD_AXIS_Z = 0,          // analog plunger
+	PAD_AXIS_LEFT_TRIGGER,   // analog flippers
+	PAD_AXIS_RIGHT_TRIGGER,
+	NUM_PAD_AXES
+};
+
+// Every axis in one report, -127..127, indexed by PAD_AXIS; changed has a bit per axis that moved
+// since the last call. Backends without a gamepad ignore it. Goes through axisReporter, not called directly
+void outputGamepadAxes(const int8_t values[NUM_PAD_AXES], uint8_t changed);
+// How often the link can usefully take a report: the BLE connection interval or the USB polling
+// interval; 0 when there is no limit
+uint32_t outputReportIntervalUs();
+
+#ifdef OUTPUT_BACKEND_FAKE
+enum FAKE_OUTPUT_EVENT {
+	FAKE_KEY_PRESS = 0,
+	FAKE_KEY_RELEASE,
+	FAKE_RELEASE_ALL,
+	FAKE_PAD_PRESS,
+	FAKE_PAD_RELEASE,
+	FAKE_PAD_AXIS
+};
+
+struct FakeOutputEvent {
+	uint8_t type;
+	uint8_t code;
+	int8_t value;            // axis value for FAKE_PAD_AXIS; one event per changed axis
+};
+
+#define FAKE_OUTPUT_LOG_LENGTH  64
+
+// Oldest first; the log stops recording when full
+const FakeOutputEvent* fakeOutputLog(uint8_t* count);
+void fakeOutputClear();
+// outputGamepadAxes() calls since the last clear; the log has one FAKE_PAD_AXIS per changed axis
+uint8_t fakeOutputAxisReports();
+void fakeOutputSetConnected(bool connected);
+// 0 (the default) is a link with no limit
+void fakeOutputSetReportInterval(uint32_t intervalUs);
+#endif
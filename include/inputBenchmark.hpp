@@ -0,0 +1,12 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Build the "benchmark" environment (or add -DINPUT_BENCHMARK) to compile the input hot path
+// benchmarks in; they run once after setup() and again on the "bench" console command. Call from
+// the system task: the measurements run on the input task, the printing stays here
+#define BENCH_ITERATIONS        1000
+#define BENCH_SLOW_ITERATIONS   100   // I2C reads and BLE report sends
+
+void runInputBenchmarks();
+void benchCommand(const char* args);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+#include "boardPins.hpp"
+
+// Uncomment to read the buttons from an MCP23017 instead of the 74HC165. Buttons go on GPA0-7 in the
+// same bit order as the shift register, switch to ground, using the expander's pull-ups
+//#define INPUT_EXPANDER
+
+// On its own I2C bus (EXPANDER_SDA, EXPANDER_SCL, EXPANDER_INT in boardPins.hpp), so the input task
+// never waits behind the accelerometer
+#define EXPANDER_ADDRESS      0x20
+#define EXPANDER_I2C_HZ       1000000
+#define EXPANDER_RESYNC_MS    1000   // full read even without an interrupt, in case one was missed
+
+// A switch that closed and opened again between two reads only shows up in INTCAP. Either it was
+// a real press too short to see on the port, or contact bounce; SETTING_EXPANDER_PULSES picks
+enum EXPANDER_PULSE_MODE {
+	EXPANDER_PULSE_BOUNCE = 0,   // restart the bit's debounce timer and drop the pulse
+	EXPANDER_PULSE_PRESS         // hold the captured level for one debounce time, then the current one
+};
+
+const int32_t EXPANDER_PULSE_DEFAULT = EXPANDER_PULSE_PRESS;   // default for SETTING_EXPANDER_PULSES
+
+// MCP23017 registers, IOCON.BANK = 0
+#define MCP_IODIRA            0x00
+#define MCP_GPINTENA          0x04
+#define MCP_INTCONA           0x08
+#define MCP_IOCON             0x0A
+#define MCP_GPPUA             0x0C
+#define MCP_INTCAPA           0x10
+#define MCP_GPIOA             0x12
+
+#ifdef INPUT_EXPANDER
+bool expanderBegin();
+// Same contract as readShiftRegister() (1 = released), but the bus is only touched when INTA says
+// something changed; otherwise the last state comes back
+uint8_t readExpander();
+#else
+inline bool expanderBegin() { return false; }
+#endif
+
+void expanderCommand(const char* args);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+#include "arcadeButtonProcessor.hpp"
+
+// Every source that can hold a key is an owner: each input bit owns the keys of its action and the
+// accelerometer owns the nudge key. A key goes down when its first owner presses it and up when its
+// last owner lets go, so overlapping sources (a MagnaSave held through a nudge on the same key)
+// never send a second press or an early release
+#define KEY_OWNER_NUDGE     NUM_INPUT_BITS
+#define KEY_OWNER_PLUNGER   (NUM_INPUT_BITS + 1)    // timed presses from the analog plunger
+#define NUM_KEY_OWNERS      (NUM_INPUT_BITS + 2)
+
+#define MAX_PAD_BUTTONS     32    // gamepad buttons are numbered 1..MAX_PAD_BUTTONS
+#define MAX_OWNER_HOLDS     4     // keys and buttons one owner can hold at once (a macro needs 3)
+
+// Call these only from the input task; pressing twice or releasing a key the owner doesn't
+// hold does nothing
+void pressKey(uint8_t owner, uint8_t key);
+void releaseKey(uint8_t owner, uint8_t key);
+void pressPadButton(uint8_t owner, uint8_t button);
+void releasePadButton(uint8_t owner, uint8_t button);
+
+// Drops every owner and sends an empty report; the axis reporter starts over too
+void releaseAllKeys();
+// Lets go of everything one owner holds; keys other owners still hold stay down
+void releaseOwner(uint8_t owner);
+
+// For the safety supervisor's hold limit: how many owners hold anything, whether one does, and
+// millis() since it has held something without a break
+uint8_t holdingOwnerCount();
+bool ownerHolding(uint8_t owner);
+unsigned long ownerHeldSince(uint8_t owner);
+
+void keysCommand(const char* args);
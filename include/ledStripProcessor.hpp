@@ -1,13 +1,10 @@
-#pragma once
-
-#include <Adafruit_NeoPixel.h>
-
-#define PIN_LED_STRIP          13
-#define NUM_STRIP_LEDS         50
-
-const uint32_t gameModeColors[] = {
-	0x0000FF,  // Blue
-	0xFF00FF   // Purple/Magenta
-};
-
-void setLEDStrip(int);
+#pragma once
+
+#include <Adafruit_NeoPixel.h>
+#include "boardPins.hpp"         // PIN_LED_STRIP
+
+#define NUM_STRIP_LEDS         50
+#define LED_STRIP_BRIGHTNESS   100    // default for SETTING_LED_BRIGHTNESS
+
+void setLEDStrip(int);
+void serviceLEDStrip();
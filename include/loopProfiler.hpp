@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include "taskManager.hpp"
+
+// Uncomment to time every stage of the system task; report with the "prof" console command.
+// The input task is timed separately by the "tasks" command
+//#define LOOP_PROFILER
+
+#define PROFILE_BUCKETS          12     // power of two buckets in us: 0, 1, 2-3, 4-7 ... >=1024
+// Iterations this far past the system task period count as stalls; at exactly the period every
+// iteration that merely waited one tick late would count
+#define PROFILE_STALL_MARGIN_US  500
+#define PROFILE_STALL_US         (SYSTEM_TASK_PERIOD_MS * 1000 + PROFILE_STALL_MARGIN_US)
+
+enum PROFILE_STAGE {
+	STAGE_CONSOLE = 0,
+	STAGE_BOOT_BUTTON,
+	STAGE_NUDGE,
+	STAGE_LED_STATUS,
+	NUM_PROFILE_STAGES
+};
+
+#ifdef LOOP_PROFILER
+void profileLoopBegin();
+void profileStageEnd(PROFILE_STAGE stage);
+#define PROFILE_LOOP_BEGIN()     profileLoopBegin()
+#define PROFILE_STAGE_END(stage) profileStageEnd(stage)
+#else
+#define PROFILE_LOOP_BEGIN()
+#define PROFILE_STAGE_END(stage)
+#endif
+
+void profileCommand(const char* args);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Light sleep and the ULP don't fit this board: the shift register's data line (GPIO7) isn't an RTC
+// GPIO the ULP could read, and the Arduino core is built without power management, so Bluedroid
+// can't keep a link or advertising through light sleep. Idle mode drops the CPU clock instead; the
+// input task keeps scanning every millisecond, so the first press is never waiting for a wake
+#define ACTIVE_CPU_MHZ    240
+#define IDLE_CPU_MHZ      80      // lowest clock the radio still runs at
+
+const int32_t IDLE_AFTER_S = 60;  // default for SETTING_IDLE_AFTER_S; 0 never idles
+
+// System task: goes idle after IDLE_AFTER_S without a button edge, nudge or link change and
+// back to full speed on the next one
+void servicePower();
+void powerCommand(const char* args);
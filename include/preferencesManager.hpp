@@ -1,20 +1,70 @@
-#pragma once
-
-#include <Preferences.h>
-
-#define BOOT_BUTTON 0 // using the Boot button to switch modes
-
-// define game modes
-#define MODE_QUEST_PINBALLFXVR         0
-#define MODE_PC_VISUALPINBALL          1
-
-enum GAME_MODE {
-	QUEST_PINBALL_FX_VR = 0,
-	PC_VISUAL_PINBALL = 1
-};
-
-int getControllerMode();
-
-void saveControllerMode(int);
-
-void gotoNextMode(int);
\ No newline at end of file
+#pragma once
+
+#include <Arduino.h>
+
+#define BOOT_BUTTON 0 // using the Boot button to switch modes
+
+// define game modes; each one has an entry in gameProfiles[]
+enum GAME_MODE {
+	QUEST_PINBALL_FX_VR = 0,
+	PC_VISUAL_PINBALL,
+	PC_PINBALL_FX,
+	PC_ZACCARIA,
+	PC_FUTURE_PINBALL,
+	PC_MAME,
+	NUM_GAME_MODES
+};
+
+#define SETTINGS_NAMESPACE         "pb"
+#define SETTINGS_FLUSH_DELAY_MS    2000   // dirty settings are committed together this long after the last change
+
+// Every setting lives in RAM after loadSettings(); add new ones here and to settingsSchema[]
+enum SETTING {
+	SETTING_CONTROLLER_MODE = 0,
+	SETTING_DEBOUNCE_MS,
+	SETTING_NUDGE_THRESHOLD,
+	SETTING_NUDGE_PRESS_MS,
+	SETTING_NUDGE_COOLDOWN_MS,
+	SETTING_LED_BRIGHTNESS,
+	SETTING_KEY_HOLD_LIMIT_S,
+	SETTING_COIL_HOLD_LIMIT_MS,
+	SETTING_IDLE_AFTER_S,
+	SETTING_PLUNGER_MODE,
+	SETTING_FLIPPER_PRESS,
+	SETTING_FLIPPER_HYSTERESIS,
+	SETTING_AXIS_EPSILON,
+	SETTING_AXIS_REFRESH_MS,
+	SETTING_EXPANDER_PULSES,
+	NUM_SETTINGS
+};
+
+struct SettingSchema {
+	const char* key;        // NVS key, 15 characters at most
+	int32_t defaultValue;
+	int32_t minValue;
+	int32_t maxValue;
+};
+
+extern int32_t settingValues[NUM_SETTINGS];
+
+// Reads never touch flash
+inline int32_t getSetting(SETTING id){
+	return settingValues[id];
+}
+
+void loadSettings();
+bool setSetting(SETTING id, int32_t value);
+void serviceSettings();
+void flushSettings();
+void settingsCommand(const char* args);
+
+// Larger records (button maps) stored next to the settings; written and committed immediately
+bool loadSettingsBlob(const char* key, void* data, size_t length);
+void saveSettingsBlob(const char* key, const void* data, size_t length);
+void eraseSettingsBlob(const char* key);
+
+int getControllerMode();
+
+void saveControllerMode(int);
+
+int gotoNextMode(int);
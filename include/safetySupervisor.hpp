@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Defaults; the live values come from the settings store (0 turns a limit off)
+const int32_t KEY_HOLD_LIMIT_S = 120;     // a key held this long is treated as stuck
+const int32_t COIL_HOLD_LIMIT_MS = 10000; // the longest a flipper solenoid may stay energized
+
+enum RELEASE_REASON {
+	RELEASE_DISCONNECT = 0,
+	RELEASE_MODE_CHANGE,
+	RELEASE_KEY_TIMEOUT,
+	RELEASE_COIL_TIMEOUT,
+	NUM_RELEASE_REASONS
+};
+
+// Runs first in every input task step, whether or not the output is connected. Releases every key
+// and coil when the link drops, re-reads the buttons when it comes back, and lets go of any key or
+// coil held past its limit; the button stays debounced as pressed, so nothing is sent again until
+// it is released and pressed
+void serviceSafety(bool connected);
+
+// Every key up and every coil off; counted under the reason
+void forceReleaseAll(uint8_t reason);
+
+void safetyCommand(const char* args);
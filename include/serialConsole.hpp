@@ -0,0 +1,15 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define CONSOLE_LINE_LENGTH   48
+
+struct ConsoleCommand {
+	const char* name;
+	// Runs on the system task; a command that changes state the input task owns hands just that
+	// change to runOnInputTask and does its printing and flash access itself
+	void (*handler)(const char* args);
+};
+
+// Non-blocking; reads whatever is waiting on Serial and runs a command once a full line arrives
+void serviceSerialConsole();
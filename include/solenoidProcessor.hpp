@@ -1,11 +1,21 @@
-#pragma once
-
-#include <Arduino.h>
-
-#define LEFT_SOLENOID         26
-#define RIGHT_SOLENOID        25
-
-void sendLeftFlipperDataHigh();
-void sendRightFlipperDataHigh();
-void sendLeftFlipperDataLow();
-void sendRightFlipperDataLow();
+#pragma once
+
+#include <Arduino.h>
+#include "boardPins.hpp"
+
+// LEFT_SOLENOID and RIGHT_SOLENOID pins in boardPins.hpp
+enum COIL {
+	COIL_LEFT = 0,
+	COIL_RIGHT,
+	NUM_COILS
+};
+
+void sendLeftFlipperDataHigh();
+void sendRightFlipperDataHigh();
+void sendLeftFlipperDataLow();
+void sendRightFlipperDataLow();
+
+// Tracked so the safety supervisor can see how long a coil has been energized
+bool coilEnergized(uint8_t coil);
+unsigned long coilOnSince(uint8_t coil);    // millis() when it was energized
+void releaseCoil(uint8_t coil);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Arduino.h>
+
+// setup() only does what BLE advertising needs; the rest runs from loop() one stage at a time
+enum STARTUP_STAGE {
+	STARTUP_ACCELEROMETER = 0,   // probe the MPU6050
+	STARTUP_CALIBRATION,         // baseline readings, spaced out over several loops
+	STARTUP_LED_STRIP,
+	STARTUP_DONE
+};
+
+void startupBegin();
+void startupAdvertisingStarted();
+void serviceStartup();
+bool startupComplete();
+void bootCommand(const char* args);
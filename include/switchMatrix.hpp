@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+#include "boardPins.hpp"
+
+// Uncomment to scan an 8x8 diode matrix (64 switches) instead of a single row of 8. A 74HC138 on
+// three GPIOs pulls one row low at a time and the 74HC165 reads the columns, so the matrix only
+// costs three pins more than the plain shift register
+//#define SWITCH_MATRIX
+
+// Row selects MATRIX_ROW_A0-A2 in boardPins.hpp
+#define MATRIX_ROWS           8
+#define MATRIX_SETTLE_US      2     // row select to column load
+
+#ifdef SWITCH_MATRIX
+void switchMatrixBegin();
+// Reads every row once, bit = row * 8 + column, 1 = released like the shift register. Runs every
+// input task tick, so the scan rate is the tick rate and the cost is the same eight row reads
+// whatever is pressed
+uint64_t scanSwitchMatrix();
+#else
+inline void switchMatrixBegin() {}
+#endif
+
+void matrixCommand(const char* args);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Bluedroid and its controller run on core 0 in the Arduino core, so the input path gets core 1
+// to itself; everything else shares core 0 with the BLE stack
+#define INPUT_TASK_CORE          1
+#define INPUT_TASK_PRIORITY      (configMAX_PRIORITIES - 5)
+#define INPUT_TASK_PERIOD_MS     1
+#define INPUT_TASK_STACK         4096
+
+#define SYSTEM_TASK_CORE         0
+#define SYSTEM_TASK_PRIORITY     2     // below the Bluedroid tasks
+#define SYSTEM_TASK_PERIOD_MS    1
+#define SYSTEM_TASK_STACK        8192
+
+enum APP_TASK {
+	TASK_INPUT = 0,          // scan, debounce, nudge keys, HID report build
+	TASK_SYSTEM,             // console, settings, BLE connection, accelerometer, LEDs
+	NUM_APP_TASKS
+};
+
+// Starts both periodic tasks; each step runs once per period
+void startTasks(void (*inputStep)(), void (*systemStep)());
+
+// Runs job(args) on the input task between two scans and waits for it to finish. For anything that
+// changes state the input task owns (button map, mode switch, benchmarks); keep the job to the
+// change itself, with no Serial or flash. Before startTasks() it just runs inline
+void runOnInputTask(void (*job)(const char* args), const char* args);
+
+void tasksCommand(const char* args);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Uncomment to record raw inputs, accelerometer samples and HID events into the trace buffer
+//#define TRACE_CAPTURE
+
+#define TRACE_BUFFER_SIZE_PSRAM   (1024 * 1024)  // used when PSRAM is available
+#define TRACE_BUFFER_SIZE_HEAP    (32 * 1024)    // fallback in internal RAM
+#define TRACE_BLOCK_SIZE          1024           // every block restarts the delta encoding
+#define TRACE_FORMAT_VERSION      1
+
+// Record types; each record is <type><varint delta us><payload>
+enum TRACE_RECORD {
+	TRACE_RAW_INPUT   = 1,   // varint raw input word
+	TRACE_ACCEL       = 2,   // zigzag varint delta of x, y, z vs previous sample in the block
+	TRACE_HID_PRESS   = 3,   // key
+	TRACE_HID_RELEASE = 4    // key
+};
+
+#ifdef TRACE_CAPTURE
+void traceBegin();
+void traceRawInput(uint64_t raw);
+void traceAccelSample(int16_t x, int16_t y, int16_t z);
+void traceHidEvent(uint8_t key, bool pressed);
+#else
+inline void traceBegin() {}
+inline void traceRawInput(uint64_t) {}
+inline void traceAccelSample(int16_t, int16_t, int16_t) {}
+inline void traceHidEvent(uint8_t, bool) {}
+#endif
+
+void traceCommand(const char* args);
@@ -1,105 +1,113 @@
-#include "accelerometerProcessor.hpp"
-
-extern int currentGameMode;
-extern bool nudgeActive;
-extern MPU6050 mpu;
-extern bool accelerometerEnabled;
-
-int16_t ax, ay, az;
-int16_t baseX = 0, baseY = 0, baseZ = 0;  // Calibration values
-
-char activeNudgeKey = 0;
-
-unsigned long nudgeStartTime = 0;
-unsigned long lastNudgeTime = 0;
-
-void tryToStartAccelerometer(){
-	// Try to configure accelerometer aka MPU6050
-	if (mpu.testConnection()) {
-		Serial.println("MPU6050 connected!");
-		accelerometerEnabled = true;
-		
-		// Calibrate baseline (average of 10 readings)
-		long sumX = 0, sumY = 0, sumZ = 0;
-		for(int i = 0; i < 10; i++) {
-			mpu.getAcceleration(&ax, &ay, &az);
-			sumX += ax;
-			sumY += ay;
-			sumZ += az;
-			delay(10); // we're in setup so this delay is fine
-		}
-		baseX = sumX / 10;
-		baseY = sumY / 10;
-		baseZ = sumZ / 10;
-	} else {
-		Serial.println("MPU6050 not found!");
-		accelerometerEnabled = false;
-	}
-}
-
-// Non-blocking nudge check
-void checkNudge(BleKeyboard* keyboard){
-	if (!accelerometerEnabled) return;
-	if (!keyboard) return;
-	
-	// Handle active nudge release
-	if (nudgeActive && (millis() - nudgeStartTime >= NUDGE_PRESS_TIME)) {
-		if (activeNudgeKey != 0) {
-			keyboard->release(activeNudgeKey);
-		}
-		nudgeActive = false;
-		activeNudgeKey = 0;
-	}
-	
-	// Check cooldown
-	if (nudgeActive || (millis() - lastNudgeTime < NUDGE_COOLDOWN)) return;
-	
-	mpu.getAcceleration(&ax, &ay, &az);
-	
-	int16_t deltaX = ax - baseX;
-	int16_t deltaY = ay - baseY;
-	
-	switch(currentGameMode) {
-		case MODE_QUEST_PINBALLFXVR:
-			// Quest uses A/S/D/F for 4*-way nudge... * I think up and down are the same (visually and phsyically)
-			if (abs(deltaX) > NUDGE_THRESHOLD || abs(deltaY) > NUDGE_THRESHOLD) {
-				// Determine primary axis
-				if (abs(deltaX) > abs(deltaY)) {
-					// X-axis dominates
-					if (deltaX > 0) {
-						keyboard->press(KEY_RMAGNASAVE_QPVR);
-						activeNudgeKey = KEY_RMAGNASAVE_QPVR;
-					} else {
-						keyboard->press(KEY_LMAGNASAVE_QPVR);
-						activeNudgeKey = KEY_LMAGNASAVE_QPVR;
-					}
-				}
-				lastNudgeTime = millis();
-				nudgeStartTime = millis();
-				nudgeActive = true;
-			}
-			break;
-			
-		case MODE_PC_VISUALPINBALL:
-			// PC pinball uses Z/X/Space for nudge
-			if (abs(deltaX) > NUDGE_THRESHOLD) {
-				if (deltaX > 0) {
-					keyboard->press('/');
-					activeNudgeKey = '/';
-				} else {
-					keyboard->press('z');
-					activeNudgeKey = 'z';
-				}
-				lastNudgeTime = millis();
-				nudgeStartTime = millis();
-				nudgeActive = true;
-			} else if (abs(deltaY) > NUDGE_THRESHOLD) {
-				keyboard->press(' ');
-				lastNudgeTime = millis();
-				nudgeStartTime = millis();
-				nudgeActive = true;
-				activeNudgeKey = ' ';  // Space for forward/back
-			}
-			break;
-	}
+#include "accelerometerProcessor.hpp"
+#include "traceRecorder.hpp"
+#include "gameProfiles.hpp"
+#include "eventBus.hpp"
+
+extern MPU6050 mpu;
+extern bool accelerometerEnabled;
+
+int16_t ax, ay, az;
+int16_t baseX = 0, baseY = 0, baseZ = 0;  // Calibration values
+
+static bool nudgeActive = false;
+uint8_t activeNudgeKey = 0;
+
+unsigned long nudgeStartTime = 0;
+unsigned long lastNudgeTime = 0;
+
+static long calibrationSum[3] = {0, 0, 0};
+static uint8_t calibrationSamples = 0;
+static unsigned long lastCalibrationSample = 0;
+
+// Probe only; the baseline is taken afterwards by serviceAccelerometerCalibration() so boot never waits on it
+bool tryToStartAccelerometer(){
+	// Start accelerometer pins and init (chip is MPU6050)
+	Wire.begin(ACCELEROMETER_SDA, ACCELEROMETER_SCL);
+	mpu.initialize();
+
+	// Try to configure accelerometer aka MPU6050
+	accelerometerEnabled = false;
+	calibrationSamples = 0;
+	calibrationSum[0] = calibrationSum[1] = calibrationSum[2] = 0;
+	if (mpu.testConnection()) {
+		Serial.println("MPU6050 connected!");
+		return true;
+	}
+	Serial.println("MPU6050 not found!");
+	return false;
+}
+
+// Takes one baseline reading per call, CALIBRATION_INTERVAL_MS apart; nudges are enabled once the
+// average of CALIBRATION_SAMPLES readings is in. Returns true when calibration is finished.
+bool serviceAccelerometerCalibration(){
+	if (accelerometerEnabled) return true;
+	if (calibrationSamples > 0 && millis() - lastCalibrationSample < CALIBRATION_INTERVAL_MS) return false;
+
+	mpu.getAcceleration(&ax, &ay, &az);
+	calibrationSum[0] += ax;
+	calibrationSum[1] += ay;
+	calibrationSum[2] += az;
+	lastCalibrationSample = millis();
+	if (++calibrationSamples < CALIBRATION_SAMPLES) return false;
+
+	baseX = calibrationSum[0] / CALIBRATION_SAMPLES;
+	baseY = calibrationSum[1] / CALIBRATION_SAMPLES;
+	baseZ = calibrationSum[2] / CALIBRATION_SAMPLES;
+	accelerometerEnabled = true;
+	return true;
+}
+
+// Forget any nudge in progress; the mode switch has already released every key
+void resetNudge(){
+	if (nudgeActive) publishEvent(EVENT_NUDGE, activeNudgeKey, 0);
+	nudgeActive = false;
+	activeNudgeKey = 0;
+}
+
+// Non-blocking nudge check. Runs on the system task and only publishes EVENT_NUDGE;
+// the input task presses and releases the key
+void checkNudge(){
+	if (!accelerometerEnabled) return;
+
+	static EventSubscriber* modeEvents = subscribeEvents("nudge", EVENT_MASK(EVENT_MODE_CHANGE));
+	Event event;
+	while (modeEvents && modeEvents->pop(event)) {
+		resetNudge();
+	}
+	
+	const unsigned long pressTime = getSetting(SETTING_NUDGE_PRESS_MS);
+	const unsigned long cooldown = getSetting(SETTING_NUDGE_COOLDOWN_MS);
+	const int threshold = getSetting(SETTING_NUDGE_THRESHOLD);
+
+	// Handle active nudge release
+	if (nudgeActive && (millis() - nudgeStartTime >= pressTime)) {
+		publishEvent(EVENT_NUDGE, activeNudgeKey, 0);
+		nudgeActive = false;
+		activeNudgeKey = 0;
+	}
+	
+	// Check cooldown
+	if (nudgeActive || (millis() - lastNudgeTime < cooldown)) return;
+	
+	mpu.getAcceleration(&ax, &ay, &az);
+	traceAccelSample(ax, ay, az);
+	
+	int16_t deltaX = ax - baseX;
+	int16_t deltaY = ay - baseY;
+	
+	if (abs(deltaX) <= threshold && abs(deltaY) <= threshold) return;
+
+	// A direction the profile leaves unmapped (Quest has no forward nudge) presses nothing but
+	// still starts the cooldown
+	const NudgeKeys& keys = activeProfile->nudge;
+	bool sideways = keys.sidewaysFirst ? (abs(deltaX) > threshold) : (abs(deltaX) > abs(deltaY));
+	if (sideways) {
+		activeNudgeKey = (deltaX > 0) ? keys.right : keys.left;
+	} else {
+		activeNudgeKey = keys.forward;
+	}
+	lastNudgeTime = millis();
+	nudgeStartTime = millis();
+	nudgeActive = true;
+	publishEvent(EVENT_NUDGE, activeNudgeKey, 1);
 }
\ No newline at end of file
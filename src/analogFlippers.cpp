@@ -0,0 +1,64 @@
+#include "analogFlippers.hpp"
+
+#ifdef ANALOG_FLIPPERS
+
+#include "analogInputs.hpp"
+#include "hidOutput.hpp"
+#include "axisReporter.hpp"
+#include "preferencesManager.hpp"
+
+struct AnalogFlipper {
+	const char* name;
+	uint8_t input;           // ANALOG_INPUT
+	uint8_t bit;             // BTN_BIT_*
+	uint8_t axis;            // PAD_AXIS
+};
+
+static const AnalogFlipper flippers[] = {
+	{"left",  ANALOG_IN_LFLIPPER, BTN_BIT_LFLIPPER, PAD_AXIS_LEFT_TRIGGER},
+	{"right", ANALOG_IN_RFLIPPER, BTN_BIT_RFLIPPER, PAD_AXIS_RIGHT_TRIGGER}
+};
+#define NUM_ANALOG_FLIPPERS   (sizeof(flippers) / sizeof(flippers[0]))
+
+static bool pressed[NUM_ANALOG_FLIPPERS];
+static uint32_t pressCount[NUM_ANALOG_FLIPPERS];
+
+void serviceFlippers(){
+	int32_t pressPoint = getSetting(SETTING_FLIPPER_PRESS);
+	// A hysteresis at or above the press point would leave nothing below the release point; a
+	// flipper back at rest (0) always releases
+	int32_t releasePoint = pressPoint - getSetting(SETTING_FLIPPER_HYSTERESIS);
+	if (releasePoint < 1) releasePoint = 1;
+
+	for (uint8_t i = 0; i < NUM_ANALOG_FLIPPERS; i++) {
+		const AnalogFlipper& flipper = flippers[i];
+		int32_t position = analogPosition(flipper.input);
+		if (!pressed[i] && position >= pressPoint) {
+			pressed[i] = true;
+			pressCount[i]++;
+		} else if (pressed[i] && position < releasePoint) {
+			pressed[i] = false;
+		}
+		// Mapped to a gamepad button ("map"), the flipper also drives its trigger
+		if (activeButtonMap[flipper.bit].type == ACTION_GAMEPAD_BUTTON) reportAxis(flipper.axis, position * 254 / ANALOG_FULL_SCALE - 127);
+	}
+}
+
+InputWord applyAnalogFlippers(InputWord raw){
+	for (uint8_t i = 0; i < NUM_ANALOG_FLIPPERS; i++) {
+		InputWord mask = INPUT_BIT(flippers[i].bit);
+		raw = pressed[i] ? (raw & ~mask) : (raw | mask);
+	}
+	return raw;
+}
+
+void printFlipperStatus(){
+	Serial.printf("Flippers press at %d, release below %d\n", (int)getSetting(SETTING_FLIPPER_PRESS),
+		(int)(getSetting(SETTING_FLIPPER_PRESS) - getSetting(SETTING_FLIPPER_HYSTERESIS)));
+	for (uint8_t i = 0; i < NUM_ANALOG_FLIPPERS; i++) {
+		Serial.printf("  %-5s pos %4u %-8s %u presses\n", flippers[i].name, analogPosition(flippers[i].input),
+			pressed[i] ? "pressed" : "released", pressCount[i]);
+	}
+}
+
+#endif
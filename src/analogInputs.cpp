@@ -0,0 +1,181 @@
+#include "analogInputs.hpp"
+
+#ifdef ANALOG_INPUTS
+
+#include <driver/adc.h>
+#include "preferencesManager.hpp"
+#include "directInputs.hpp"
+#include "analogPlunger.hpp"
+#include "analogFlippers.hpp"
+#include "axisReporter.hpp"
+
+#if defined(ANALOG_PLUNGER) && defined(DIRECT_INPUTS) && (DIRECT_PIN_RFLIPPER == 32 || DIRECT_PIN_LFLIPPER == 32)
+#error "GPIO32 can't be both the analog plunger and a direct flipper input"
+#endif
+
+#define NO_ANALOG_INPUT   0xFF
+
+struct AnalogInput {
+	const char* name;
+	uint8_t channel;         // ADC1 channel
+	bool enabled;
+};
+
+#ifdef ANALOG_PLUNGER
+#define ANALOG_PLUNGER_ENABLED   true
+#else
+#define ANALOG_PLUNGER_ENABLED   false
+#endif
+#ifdef ANALOG_FLIPPERS
+#define ANALOG_FLIPPERS_ENABLED  true
+#else
+#define ANALOG_FLIPPERS_ENABLED  false
+#endif
+
+static const AnalogInput analogInputs[NUM_ANALOG_INPUTS] = {
+	{"plunger", ANALOG_PLUNGER_CHANNEL,  ANALOG_PLUNGER_ENABLED},
+	{"lflip",   ANALOG_LFLIPPER_CHANNEL, ANALOG_FLIPPERS_ENABLED},
+	{"rflip",   ANALOG_RFLIPPER_CHANNEL, ANALOG_FLIPPERS_ENABLED}
+};
+
+static uint8_t channelInput[16];                      // ADC1 channel -> ANALOG_INPUT
+static int32_t filtered[NUM_ANALOG_INPUTS];           // 1/16 ADC counts
+static uint16_t positions[NUM_ANALOG_INPUTS];
+static AnalogCalibration calibration[NUM_ANALOG_INPUTS];
+static uint32_t samplesTaken = 0;
+static bool adcRunning = false;
+
+void analogInputsBegin(){
+	if (!loadSettingsBlob("analogCal", calibration, sizeof(calibration))) {
+		for (uint8_t i = 0; i < NUM_ANALOG_INPUTS; i++) {
+			calibration[i].rest = 0;
+			calibration[i].full = 4095;
+		}
+	}
+
+	memset(channelInput, NO_ANALOG_INPUT, sizeof(channelInput));
+	adc_digi_pattern_config_t pattern[NUM_ANALOG_INPUTS];
+	uint32_t channelMask = 0;
+	uint8_t patternCount = 0;
+	for (uint8_t i = 0; i < NUM_ANALOG_INPUTS; i++) {
+		if (!analogInputs[i].enabled) continue;
+		channelInput[analogInputs[i].channel] = i;
+		channelMask |= (1UL << analogInputs[i].channel);
+		pattern[patternCount].atten = ADC_ATTEN_DB_11;
+		pattern[patternCount].channel = analogInputs[i].channel;
+		pattern[patternCount].unit = 0;
+		pattern[patternCount].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+		patternCount++;
+	}
+
+	adc_digi_init_config_t init = {};
+	init.max_store_buf_size = ANALOG_READ_BYTES * 4;
+	init.conv_num_each_intr = ANALOG_READ_BYTES / 4;
+	init.adc1_chan_mask = channelMask;
+	adc_digi_configuration_t config = {};
+	config.conv_limit_en = true;
+	config.conv_limit_num = 250;
+	config.pattern_num = patternCount;
+	config.adc_pattern = pattern;
+	config.sample_freq_hz = ANALOG_SAMPLE_HZ;
+	config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+	config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+	if (adc_digi_initialize(&init) != ESP_OK || adc_digi_controller_configure(&config) != ESP_OK
+			|| adc_digi_start() != ESP_OK) {
+		Serial.println("ADC DMA setup failed!");
+		return;
+	}
+	adcRunning = true;
+}
+
+static uint16_t scalePosition(int32_t raw, const AnalogCalibration& cal){
+	int32_t span = (int32_t)cal.full - cal.rest;
+	if (span == 0) return 0;
+	int32_t position = (raw - cal.rest) * ANALOG_FULL_SCALE / span;
+	return constrain(position, 0, ANALOG_FULL_SCALE);
+}
+
+void processAnalogInputs(){
+	if (!adcRunning) return;
+	static uint8_t buffer[ANALOG_READ_BYTES];
+	uint32_t sums[NUM_ANALOG_INPUTS] = {0};
+	uint16_t counts[NUM_ANALOG_INPUTS] = {0};
+
+	// A tick's worth is well under one buffer; the cap only matters after a stall
+	uint32_t length = 0;
+	for (uint8_t reads = 0; reads < 4; reads++) {
+		if (adc_digi_read_bytes(buffer, sizeof(buffer), &length, 0) != ESP_OK || length == 0) break;
+		for (uint32_t i = 0; i + sizeof(adc_digi_output_data_t) <= length; i += sizeof(adc_digi_output_data_t)) {
+			const adc_digi_output_data_t* sample = (const adc_digi_output_data_t*)&buffer[i];
+			uint8_t input = channelInput[sample->type1.channel];
+			if (input == NO_ANALOG_INPUT) continue;
+			sums[input] += sample->type1.data;
+			counts[input]++;
+		}
+	}
+
+	for (uint8_t i = 0; i < NUM_ANALOG_INPUTS; i++) {
+		if (!counts[i]) continue;
+		samplesTaken += counts[i];
+		int32_t mean = (sums[i] << 4) / counts[i];
+		filtered[i] += (mean - filtered[i]) >> ANALOG_FILTER_SHIFT;
+		positions[i] = scalePosition(filtered[i] >> 4, calibration[i]);
+	}
+
+#ifdef ANALOG_PLUNGER
+	servicePlunger(millis());
+#endif
+#ifdef ANALOG_FLIPPERS
+	serviceFlippers();
+#endif
+	flushAxisReports();
+}
+
+uint16_t analogPosition(uint8_t input){
+	return positions[input];
+}
+
+// analog                  readings and calibration of every input
+// analog rest|full <name> take the current reading as that end of travel, and save it
+void analogCommand(const char* args){
+	char end[8], name[12];
+	if (sscanf(args, "%7s %11s", end, name) == 2) {
+		bool rest = (strcmp(end, "rest") == 0);
+		if (!rest && strcmp(end, "full") != 0) {
+			Serial.println("usage: analog [rest|full <name>]");
+			return;
+		}
+		for (uint8_t i = 0; i < NUM_ANALOG_INPUTS; i++) {
+			if (!analogInputs[i].enabled || strcmp(name, analogInputs[i].name) != 0) continue;
+			if (rest) calibration[i].rest = filtered[i] >> 4;
+			else calibration[i].full = filtered[i] >> 4;
+			saveSettingsBlob("analogCal", calibration, sizeof(calibration));
+			Serial.printf("%s %s = %u\n", name, end, filtered[i] >> 4);
+			return;
+		}
+		Serial.printf("Unknown analog input '%s'\n", name);
+		return;
+	}
+
+	for (uint8_t i = 0; i < NUM_ANALOG_INPUTS; i++) {
+		if (!analogInputs[i].enabled) continue;
+		Serial.printf("%-8s ADC1_CH%u raw %4d pos %4u  [rest %u, full %u]\n", analogInputs[i].name,
+			analogInputs[i].channel, filtered[i] >> 4, positions[i], calibration[i].rest, calibration[i].full);
+	}
+	Serial.printf("%u samples\n", samplesTaken);
+#ifdef ANALOG_PLUNGER
+	printPlungerStatus();
+#endif
+#ifdef ANALOG_FLIPPERS
+	printFlipperStatus();
+#endif
+	printAxisStatus();
+}
+
+#else
+
+void analogCommand(const char* args){
+	Serial.println("Analog inputs disabled; build with ANALOG_PLUNGER or ANALOG_FLIPPERS");
+}
+
+#endif
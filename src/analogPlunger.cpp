@@ -0,0 +1,100 @@
+#include "analogPlunger.hpp"
+
+#ifdef ANALOG_PLUNGER
+
+#include "analogInputs.hpp"
+#include "arcadeButtonProcessor.hpp"
+#include "gameProfiles.hpp"
+#include "keyArbiter.hpp"
+#include "hidOutput.hpp"
+#include "axisReporter.hpp"
+#include "preferencesManager.hpp"
+
+enum PLUNGER_STATE {
+	PLUNGER_AT_REST = 0,
+	PLUNGER_PULLED,
+	PLUNGER_FIRED            // released fast; waits for the plunger to settle before arming again
+};
+
+static uint8_t state = PLUNGER_AT_REST;
+static uint16_t history[PLUNGER_SPEED_WINDOW];
+static uint8_t historyIndex = 0;
+static uint16_t peak = 0;
+static uint8_t heldKey = 0;
+static unsigned long keyReleaseAt = 0;
+static uint32_t launches = 0;
+static uint16_t lastStrength = 0;
+static uint16_t lastSpeed = 0;
+
+// Axis mode needs a game that reads the gamepad; a keyboard profile gets timed key presses instead
+static uint8_t effectiveMode(){
+	uint8_t mode = getSetting(SETTING_PLUNGER_MODE);
+	if (mode == PLUNGER_AXIS && activeProfile->hidType != HID_TYPE_GAMEPAD) return PLUNGER_KEYS;
+	return mode;
+}
+
+// Keyboard hosts pull their plunger back while the key is held and fire on release, so the hold
+// time carries the strength. The game sees the launch that long after the real one
+static void launch(uint16_t strength, unsigned long now, uint8_t mode){
+	launches++;
+	lastStrength = strength;
+	if (mode != PLUNGER_KEYS) return;
+	const ButtonAction& action = activeButtonMap[BTN_BIT_PLUNGER];
+	if (action.type != ACTION_KEY) return;
+	if (heldKey) releaseKey(KEY_OWNER_PLUNGER, heldKey);
+	heldKey = action.codes[0];
+	pressKey(KEY_OWNER_PLUNGER, heldKey);
+	uint32_t holdMs = (uint32_t)strength * PLUNGER_FULL_PULL_MS / ANALOG_FULL_SCALE;
+	if (holdMs < PLUNGER_MIN_PRESS_MS) holdMs = PLUNGER_MIN_PRESS_MS;
+	keyReleaseAt = now + holdMs;
+}
+
+void servicePlunger(unsigned long now){
+	uint8_t mode = effectiveMode();
+	if (heldKey && (long)(now - keyReleaseAt) >= 0) {
+		releaseKey(KEY_OWNER_PLUNGER, heldKey);
+		heldKey = 0;
+	}
+	if (mode == PLUNGER_OFF) return;
+
+	uint16_t position = analogPosition(ANALOG_IN_PLUNGER);
+	uint16_t oldest = history[historyIndex];
+	history[historyIndex] = position;
+	historyIndex = (historyIndex + 1) % PLUNGER_SPEED_WINDOW;
+	int16_t speed = ((int16_t)oldest - (int16_t)position) / PLUNGER_SPEED_WINDOW;
+
+	switch (state) {
+		case PLUNGER_AT_REST:
+			if (position >= PLUNGER_ARM_POSITION) {
+				state = PLUNGER_PULLED;
+				peak = position;
+			}
+			break;
+		case PLUNGER_PULLED:
+			if (position > peak) peak = position;
+			if (speed >= PLUNGER_RELEASE_SPEED) {
+				lastSpeed = speed;
+				launch(peak, now, mode);
+				state = PLUNGER_FIRED;
+			} else if (position <= PLUNGER_REST_POSITION) {
+				state = PLUNGER_AT_REST;
+			}
+			break;
+		case PLUNGER_FIRED:
+			if (position <= PLUNGER_REST_POSITION) state = PLUNGER_AT_REST;
+			break;
+	}
+
+	if (mode == PLUNGER_AXIS) reportAxis(PAD_AXIS_Z, (int32_t)position * 127 / ANALOG_FULL_SCALE);
+}
+
+void printPlungerStatus(){
+	static const char* const stateNames[] = {"at rest", "pulled", "fired"};
+	static const char* const modeNames[] = {"off", "keys", "axis"};
+	uint8_t mode = getSetting(SETTING_PLUNGER_MODE);
+	uint8_t effective = effectiveMode();
+	Serial.printf("Plunger %s (%s%s), %u launches, last strength %u at %u/ms\n", stateNames[state],
+		modeNames[effective], (effective != mode) ? ", keyboard profile" : "", launches, lastStrength, lastSpeed);
+}
+
+#endif
@@ -1,101 +1,354 @@
-#include "arcadeButtonProcessor.hpp"
-
-extern bool nudgeActive; 
-
-uint8_t stableState = 0xFF;           // debounced state (1 = released)
-uint8_t lastRawState = 0xFF;          // last raw read
-unsigned long lastChangeTime[8] = {0};
-
-#ifdef BUTTON_DEBUG
-static void logButtonEvent(uint8_t bit, uint8_t key, const char* action) {
-	Serial.printf("Button bit %u -> key 0x%02X %s\n", bit, key, action);
-}
-#endif
-
-uint8_t readShiftRegister() {
-	digitalWrite(SR_LOAD, LOW);
-	delayMicroseconds(1);
-	digitalWrite(SR_LOAD, HIGH);
-	
-	uint8_t data = 0;
-	for (int i = 0; i < 8; i++) {
-		data <<= 1;
-		if (digitalRead(SR_DATA)) {
-			data |= 1;
-		}
-		digitalWrite(SR_CLK, HIGH);
-		delayMicroseconds(1);
-		digitalWrite(SR_CLK, LOW);
-	}
-	
-	return data;
-}
-
-void processKeyboardButtons(BleKeyboard* keyboard){
-	const ButtonMapping* map = questButtonMap;
-	uint8_t totalButtons = QUEST_NUM_BUTTONS;
-
-	if(currentGameMode == PC_VISUAL_PINBALL){
-		map = pcButtonMap;
-		totalButtons = PC_NUM_BUTTONS;
-	}
-
-	uint8_t raw = readShiftRegister();
-	unsigned long now = millis();
-
-	for (uint8_t i = 0; i < totalButtons; i++) {
-		uint8_t bit = map[i].bit;
-		char key = map[i].key;
-		bool rawPressed = !(raw & (1 << bit));
-		bool lastRawPressed = !(lastRawState & (1 << bit));
-
-		// If raw level changed, reset debounce timer
-		if (rawPressed != lastRawPressed) {
-			lastChangeTime[i] = now;
-		}
-
-		// Only update stable state after it has stayed the same for DEBOUNCE_MS
-		if ((now - lastChangeTime[i]) >= DEBOUNCE_MS) {
-			bool stablePressed = !(stableState & (1 << bit));
-			if (rawPressed != stablePressed) {
-				bool leftFlipper = (bit == BTN_BIT_LFLIPPER);
-				bool rightFlipper = (bit == BTN_BIT_RFLIPPER);
-				bool leftNudge = (bit == BTN_BIT_LMAGNASAVE);
-				bool rightNudge = (bit == BTN_BIT_RMAGNASAVE);
-
-				// Edge detected on debounced state
-				if (rawPressed) {
-					if(leftNudge && nudgeActive) return;
-					if(rightNudge && nudgeActive) return;
-					keyboard->press(key);
-					if(leftFlipper) sendLeftFlipperDataHigh();
-					else if(rightFlipper) sendRightFlipperDataHigh();
-#ifdef BUTTON_DEBUG
-					logButtonEvent(bit, key, "pressed");
-#endif
-				} else {
-					keyboard->release(key);
-					if(leftFlipper) sendLeftFlipperDataLow();
-					else if(rightFlipper) sendRightFlipperDataLow();
-#ifdef BUTTON_DEBUG
-					logButtonEvent(bit, key, "released");
-#endif
-				}
-
-				// Update debounced state bit
-				if (rawPressed) {
-					stableState &= ~(1 << bit);
-				} else {
-					stableState |= (1 << bit);
-				}
-			}
-		}
-
-		// Update lastRawState bit
-		if (rawPressed) {
-			lastRawState &= ~(1 << bit);
-		} else {
-			lastRawState |= (1 << bit);
-		}
-	}
-}
\ No newline at end of file
+#include "arcadeButtonProcessor.hpp"
+#include "traceRecorder.hpp"
+#include "gameProfiles.hpp"
+#include "bleConnectionManager.hpp"
+#include "eventBus.hpp"
+#include "keyArbiter.hpp"
+#include "directInputs.hpp"
+#include "inputExpander.hpp"
+#include "analogFlippers.hpp"
+#include "taskManager.hpp"
+
+#if defined(SWITCH_MATRIX) && defined(INPUT_EXPANDER)
+#error "SWITCH_MATRIX and INPUT_EXPANDER both replace the shift register scan; pick one"
+#endif
+
+#if defined(SWITCH_MATRIX) && defined(DIRECT_INPUTS) && defined(BOARD_MATRIX_SHARES_DIRECT_PINS)
+#error "On this board the matrix row selects are the direct input pins; pick one"
+#endif
+
+#if defined(ANALOG_FLIPPERS) && defined(DIRECT_INPUTS)
+#error "ANALOG_FLIPPERS and DIRECT_INPUTS both drive the flipper bits; pick one"
+#endif
+
+InputWord stableState = ~(InputWord)0;    // debounced state (1 = released)
+InputWord lastRawState = ~(InputWord)0;   // last raw read
+unsigned long lastChangeTime[NUM_INPUT_BITS] = {0};
+
+ButtonAction activeButtonMap[NUM_INPUT_BITS];
+static ButtonAction stagedButtonMap[NUM_INPUT_BITS];   // read from flash on the system task, then installed
+static InputWord mappedBits = 0;      // bits with an action; the rest are never looked at
+
+#ifdef BUTTON_DEBUG
+static void logButtonEvent(uint8_t bit, uint8_t key, const char* action) {
+	Serial.printf("Button bit %u -> key 0x%02X %s\n", bit, key, action);
+}
+#endif
+
+static void rebuildMappedBits(){
+	mappedBits = 0;
+	for (uint8_t bit = 0; bit < NUM_INPUT_BITS; bit++) {
+		if (activeButtonMap[bit].type != ACTION_NONE) mappedBits |= INPUT_BIT(bit);
+	}
+}
+
+static void loadBuiltInMap(int mode, ButtonAction* buttonMap){
+	const ButtonMapping* map = gameProfiles[mode].buttonMap;
+	uint8_t totalButtons = gameProfiles[mode].numButtons;
+
+	memset(buttonMap, 0, sizeof(ButtonAction) * NUM_INPUT_BITS);
+	for (uint8_t i = 0; i < totalButtons; i++) {
+		buttonMap[map[i].bit].type = ACTION_KEY;
+		buttonMap[map[i].bit].codes[0] = map[i].key;
+	}
+#ifdef SWITCH_MATRIX
+	for (uint8_t i = 0; i < NUM_COIN_DOOR_BUTTONS; i++) {
+		buttonMap[coinDoorButtonMap[i].bit].type = ACTION_KEY;
+		buttonMap[coinDoorButtonMap[i].bit].codes[0] = coinDoorButtonMap[i].key;
+	}
+#endif
+}
+
+// Checked on every action "map" enters and every action a saved map brings back; a keyboard
+// profile's game would never see a gamepad button
+static bool validAction(const ButtonAction& action, int mode){
+	switch (action.type) {
+		case ACTION_NONE:
+		case ACTION_HOST_SWITCH:
+			return true;
+		case ACTION_KEY:
+		case ACTION_MACRO:
+			return action.codes[0] != 0;
+		case ACTION_GAMEPAD_BUTTON:
+			return gameProfiles[mode].hidType == HID_TYPE_GAMEPAD
+				&& action.codes[0] >= 1 && action.codes[0] <= MAX_PAD_BUTTONS;
+		default:
+			return false;
+	}
+}
+
+// Built-in map for the mode, replaced by the user's map when one was saved for it. A saved map that
+// is corrupt or from another firmware's action types is ignored as a whole
+void stageButtonMap(int mode){
+	char key[8];
+	snprintf(key, sizeof(key), "map%d", mode);
+	bool loaded = loadSettingsBlob(key, stagedButtonMap, sizeof(stagedButtonMap));
+	for (uint8_t bit = 0; bit < NUM_INPUT_BITS && loaded; bit++) {
+		if (validAction(stagedButtonMap[bit], mode)) continue;
+		Serial.printf("Saved button map for mode %d has a bad action on bit %u; using the built-in map\n", mode, bit);
+		loaded = false;
+	}
+	if (!loaded) loadBuiltInMap(mode, stagedButtonMap);
+}
+
+void installButtonMap(){
+	memcpy(activeButtonMap, stagedButtonMap, sizeof(activeButtonMap));
+	rebuildMappedBits();
+}
+
+void loadButtonMap(int mode){
+	stageButtonMap(mode);
+	installButtonMap();
+}
+
+void saveButtonMap(int mode){
+	char key[8];
+	snprintf(key, sizeof(key), "map%d", mode);
+	saveSettingsBlob(key, activeButtonMap, sizeof(activeButtonMap));
+}
+
+// Treat every button as released; anything still held is pressed again under the current map
+void resetButtonStates(){
+	stableState = ~(InputWord)0;
+}
+
+// The bit owns every key its action holds, so a key shared with another bit or with the nudge
+// stays down until the last of them lets go
+static void pressAction(uint8_t bit, const ButtonAction& action){
+	switch (action.type) {
+		case ACTION_KEY:
+			pressKey(bit, action.codes[0]);
+			break;
+		case ACTION_MACRO:
+			for (uint8_t i = 0; i < MACRO_MAX_KEYS && action.codes[i]; i++) {
+				pressKey(bit, action.codes[i]);
+			}
+			break;
+		case ACTION_GAMEPAD_BUTTON:
+			pressPadButton(bit, action.codes[0]);
+			break;
+		case ACTION_HOST_SWITCH:
+			switchActiveHost(-1);
+			break;
+		default:
+			break;
+	}
+}
+
+static void releaseAction(uint8_t bit, const ButtonAction& action){
+	switch (action.type) {
+		case ACTION_KEY:
+			releaseKey(bit, action.codes[0]);
+			break;
+		case ACTION_MACRO:
+			for (uint8_t i = 0; i < MACRO_MAX_KEYS && action.codes[i]; i++) {
+				releaseKey(bit, action.codes[i]);
+			}
+			break;
+		case ACTION_GAMEPAD_BUTTON:
+			releasePadButton(bit, action.codes[0]);
+			break;
+		default:
+			break;
+	}
+}
+
+uint8_t readShiftRegister() {
+	digitalWrite(SR_LOAD, LOW);
+	delayMicroseconds(1);
+	digitalWrite(SR_LOAD, HIGH);
+	
+	uint8_t data = 0;
+	for (int i = 0; i < 8; i++) {
+		data <<= 1;
+		if (digitalRead(SR_DATA)) {
+			data |= 1;
+		}
+		digitalWrite(SR_CLK, HIGH);
+		delayMicroseconds(1);
+		digitalWrite(SR_CLK, LOW);
+	}
+	
+	return data;
+}
+
+void processKeyboardButtons(){
+#if defined(SWITCH_MATRIX)
+	InputWord raw = applyAnalogFlippers(applyDirectInputs(scanSwitchMatrix()));
+#elif defined(INPUT_EXPANDER)
+	InputWord raw = applyAnalogFlippers(applyDirectInputs(readExpander()));
+#else
+	InputWord raw = applyAnalogFlippers(applyDirectInputs(readShiftRegister()));
+#endif
+	traceRawInput(raw);
+	updateButtonStates(raw, millis());
+}
+
+// The accelerometer runs on the other core and only publishes nudges; the key is pressed
+// and released here so every HID report is built on the input task
+static void drainNudgeEvents(){
+	static EventSubscriber* nudgeEvents = subscribeEvents("buttons", EVENT_MASK(EVENT_NUDGE));
+	Event event;
+	while (nudgeEvents && nudgeEvents->pop(event)) {
+		if (event.code == 0) continue;
+		if (event.value) pressKey(KEY_OWNER_NUDGE, event.code);
+		else releaseKey(KEY_OWNER_NUDGE, event.code);
+	}
+}
+
+void noteInputEdge(uint8_t bit, uint8_t level, unsigned long when){
+	InputWord mask = INPUT_BIT(bit);
+	lastRawState = level ? (lastRawState | mask) : (lastRawState & ~mask);
+	lastChangeTime[bit] = when;
+}
+
+void updateButtonStates(InputWord raw, unsigned long now){
+	drainNudgeEvents();
+	unsigned long debounceMs = getSetting(SETTING_DEBOUNCE_MS);
+
+	// If raw level changed, reset debounce timer
+	InputWord changed = raw ^ lastRawState;
+	lastRawState = raw;
+	while (changed) {
+		uint8_t bit = lowestInputBit(changed);
+		changed &= changed - 1;
+		lastChangeTime[bit] = now;
+	}
+
+	// Only mapped bits whose raw level differs from the debounced state can produce an edge
+	InputWord pending = (raw ^ stableState) & mappedBits;
+	while (pending) {
+		uint8_t bit = lowestInputBit(pending);
+		pending &= pending - 1;
+
+		// Only update stable state after it has stayed the same for the debounce time
+		if ((now - lastChangeTime[bit]) < debounceMs) continue;
+
+		bool rawPressed = !(raw & INPUT_BIT(bit));
+		const ButtonAction& action = activeButtonMap[bit];
+		bool leftFlipper = (bit == BTN_BIT_LFLIPPER);
+		bool rightFlipper = (bit == BTN_BIT_RFLIPPER);
+
+		// Edge detected on debounced state. A MagnaSave pressed during a nudge on the same key
+		// just becomes a second owner of it; every edge is taken, so no bit is left stale
+		if (rawPressed) {
+			pressAction(bit, action);
+			if(leftFlipper) sendLeftFlipperDataHigh();
+			else if(rightFlipper) sendRightFlipperDataHigh();
+#ifdef BUTTON_DEBUG
+			logButtonEvent(bit, action.codes[0], "pressed");
+#endif
+		} else {
+			releaseAction(bit, action);
+			if(leftFlipper) sendLeftFlipperDataLow();
+			else if(rightFlipper) sendRightFlipperDataLow();
+#ifdef BUTTON_DEBUG
+			logButtonEvent(bit, action.codes[0], "released");
+#endif
+		}
+
+		// Update debounced state bit
+		stableState ^= INPUT_BIT(bit);
+		publishEvent(EVENT_BUTTON_EDGE, bit, rawPressed);
+	}
+}
+
+static void printButtonMap(){
+	static const char* const actionNames[NUM_ACTION_TYPES] = {"none", "key", "pad", "macro", "host"};
+	for (uint8_t bit = 0; bit < NUM_INPUT_BITS; bit++) {
+		const ButtonAction& action = activeButtonMap[bit];
+		Serial.printf("bit %u: %-5s", bit, (action.type < NUM_ACTION_TYPES) ? actionNames[action.type] : "?");
+		for (uint8_t i = 0; i < MACRO_MAX_KEYS && action.type != ACTION_NONE; i++) {
+			if (action.codes[i] == 0) break;
+			Serial.printf(" 0x%02X", action.codes[i]);
+		}
+		Serial.println();
+	}
+}
+
+// A single character is taken literally ("u", "5"); anything longer is a number ("0x85", "133")
+static uint8_t parseCode(const char* token){
+	if (token[0] != '\0' && token[1] == '\0') return token[0];
+	return strtol(token, nullptr, 0);
+}
+
+// One "map <bit> ..." change, handed from the console to the input task
+static uint8_t pendingBit;
+static ButtonAction pendingAction;
+
+// Releases the old action first so a held button can't leave its old key stuck
+static void mapBitJob(const char* args){
+	if (!(stableState & INPUT_BIT(pendingBit))) {
+		releaseAction(pendingBit, activeButtonMap[pendingBit]);
+		stableState |= INPUT_BIT(pendingBit);
+	}
+	activeButtonMap[pendingBit] = pendingAction;
+	rebuildMappedBits();
+}
+
+static void installMapJob(const char* args){
+	installButtonMap();
+}
+
+// map                          print the active map
+// map <bit> none|key|pad|macro <code>...
+// map <bit> host               switch BLE host on press
+// map save|reset               store the active map for this mode, or go back to the built-in one
+// Runs on the system task, which makes every change to the map through the input task and waits
+// for it, so reading the map here is safe; flash and Serial stay off the input task
+void mapCommand(const char* args){
+	if (*args == '\0') {
+		printButtonMap();
+		return;
+	}
+	if (strcmp(args, "save") == 0) {
+		saveButtonMap(currentGameMode);
+		Serial.println("Button map saved");
+		return;
+	}
+	if (strcmp(args, "reset") == 0) {
+		char key[8];
+		snprintf(key, sizeof(key), "map%d", currentGameMode);
+		eraseSettingsBlob(key);
+		stageButtonMap(currentGameMode);
+		runOnInputTask(installMapJob, "");
+		Serial.println("Button map reset to defaults");
+		return;
+	}
+
+	char type[8];
+	char codes[MACRO_MAX_KEYS][8] = {{0}};
+	unsigned int bit;
+	int fields = sscanf(args, "%u %7s %7s %7s %7s", &bit, type, codes[0], codes[1], codes[2]);
+	if (fields < 2 || bit >= NUM_INPUT_BITS) {
+		Serial.println("usage: map <bit> none|key|pad|macro <code>... | map <bit> host | map save | map reset");
+		return;
+	}
+
+	ButtonAction action = {ACTION_NONE, {0, 0, 0}};
+	if (strcmp(type, "key") == 0) action.type = ACTION_KEY;
+	else if (strcmp(type, "pad") == 0) action.type = ACTION_GAMEPAD_BUTTON;
+	else if (strcmp(type, "macro") == 0) action.type = ACTION_MACRO;
+	else if (strcmp(type, "host") == 0) action.type = ACTION_HOST_SWITCH;
+	else if (strcmp(type, "none") != 0) {
+		Serial.printf("Unknown action '%s'\n", type);
+		return;
+	}
+	for (uint8_t i = 0; i + 2 < fields && i < MACRO_MAX_KEYS; i++) {
+		// Gamepad buttons are always numbers, so "pad 3" means button 3 rather than the key '3'
+		action.codes[i] = (action.type == ACTION_GAMEPAD_BUTTON) ? strtol(codes[i], nullptr, 0) : parseCode(codes[i]);
+	}
+	if (action.type == ACTION_GAMEPAD_BUTTON && activeProfile->hidType != HID_TYPE_GAMEPAD) {
+		Serial.printf("%s is a keyboard profile; pad actions need a gamepad one\n", activeProfile->name);
+		return;
+	}
+	if (!validAction(action, currentGameMode)) {
+		Serial.printf("Missing code, or pad button outside 1..%d\n", MAX_PAD_BUTTONS);
+		return;
+	}
+
+	pendingBit = bit;
+	pendingAction = action;
+	runOnInputTask(mapBitJob, "");
+	printButtonMap();
+}
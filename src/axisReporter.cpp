@@ -0,0 +1,79 @@
+#include "axisReporter.hpp"
+#include "hidOutput.hpp"
+#include "preferencesManager.hpp"
+
+struct AxisReport {
+	bool active;             // given a value since the last reset
+	bool sentOnce;
+	int8_t wanted;
+	int8_t sent;
+	uint32_t sentAt;         // micros()
+	uint32_t updates;
+	uint32_t held;           // ticks a due update waited for the report interval
+};
+
+static AxisReport axes[NUM_PAD_AXES];
+static uint32_t lastFlush = 0;
+
+void reportAxis(uint8_t axis, int8_t value){
+	axes[axis].active = true;
+	axes[axis].wanted = value;
+}
+
+// The ends of the range always go out at once, so a released trigger or plunger comes to rest exactly
+static bool dueForReport(const AxisReport& report, uint32_t now, int32_t epsilon, uint32_t refreshUs){
+	if (!report.sentOnce) return true;
+	int32_t delta = abs((int32_t)report.wanted - report.sent);
+	if (delta == 0) return false;
+	if (delta >= epsilon || report.wanted == -127 || report.wanted == 127) return true;
+	return now - report.sentAt >= refreshUs;
+}
+
+void flushAxisReports(){
+	uint32_t now = micros();
+	bool intervalOpen = (now - lastFlush >= outputReportIntervalUs());
+	int32_t epsilon = getSetting(SETTING_AXIS_EPSILON);
+	uint32_t refreshUs = getSetting(SETTING_AXIS_REFRESH_MS) * 1000;
+
+	// Axes that aren't due go out unchanged, at what the host already has
+	int8_t values[NUM_PAD_AXES];
+	uint8_t changed = 0;
+	for (uint8_t axis = 0; axis < NUM_PAD_AXES; axis++) {
+		AxisReport& report = axes[axis];
+		values[axis] = report.sent;
+		if (!report.active || !dueForReport(report, now, epsilon, refreshUs)) continue;
+		if (!intervalOpen) {
+			report.held++;
+			continue;
+		}
+		values[axis] = report.wanted;
+		changed |= (1 << axis);
+		report.sent = report.wanted;
+		report.sentOnce = true;
+		report.sentAt = now;
+		report.updates++;
+	}
+	if (!changed) return;
+	outputGamepadAxes(values, changed);
+	lastFlush = now;
+}
+
+void resetAxisReports(){
+	for (uint8_t axis = 0; axis < NUM_PAD_AXES; axis++) {
+		axes[axis].active = false;
+		axes[axis].sentOnce = false;
+		axes[axis].sent = 0;
+	}
+}
+
+void printAxisStatus(){
+	static const char* const axisNames[NUM_PAD_AXES] = {"z", "ltrigger", "rtrigger"};
+	Serial.printf("Axes: epsilon %d, refresh %d ms, report interval %u us\n", (int)getSetting(SETTING_AXIS_EPSILON),
+		(int)getSetting(SETTING_AXIS_REFRESH_MS), outputReportIntervalUs());
+	for (uint8_t axis = 0; axis < NUM_PAD_AXES; axis++) {
+		const AxisReport& report = axes[axis];
+		if (!report.active) continue;
+		Serial.printf("  %-8s %4d (sent %4d), %u updates, %u held\n", axisNames[axis], report.wanted, report.sent,
+			report.updates, report.held);
+	}
+}
@@ -0,0 +1,571 @@
+#include "bleConnectionManager.hpp"
+#include "preferencesManager.hpp"
+
+#ifdef OUTPUT_BACKEND_BLE
+
+extern int currentGameMode;
+
+struct ReconnectStats {
+	uint32_t count;
+	uint32_t directedCount;      // reconnects that landed while directed advertising was running
+	uint32_t lastMs;
+	uint32_t minMs;
+	uint32_t maxMs;
+	uint64_t totalMs;
+};
+
+static portMUX_TYPE bleMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Connection table; slots are filled and emptied by the Bluetooth task, everything else is loop()
+static BleHost bleHosts[MAX_BLE_HOSTS];
+static volatile int activeHost = -1;
+static volatile int lastConnectedHost = -1;
+static volatile bool linkDropped = false;
+static volatile bool bondPending = false;
+static volatile int profileHostPending = -1;  // host switched on the input task; saved from serviceBleConnection()
+static esp_gatt_if_t gattsInterface = 0;
+static uint16_t reportHandles[NUM_BLE_REPORTS];
+static unsigned long outageStart = 0;    // micros() when a link dropped; 0 at boot
+static ReconnectStats reconnectStats = {0, 0, 0, UINT32_MAX, 0, 0};
+
+static NkroReport activeReport;          // latest keyboard state, replayed to a host when it becomes active
+static PadReport activePadReport;        // same for the gamepad
+static const NkroReport emptyReport = {};
+static const PadReport emptyPadReport = {};
+static BondedHost profileHost;           // the current profile's bonded host, cached for the GATTS handler
+
+static volatile RECONNECT_STATE reconnectState = RECONNECT_PENDING;
+static unsigned long directedStart = 0;
+
+static void hostKey(char* key, size_t length, int mode){
+	snprintf(key, length, "host%d", mode);
+}
+
+static bool loadBondedHost(int mode, BondedHost& host){
+	char key[8];
+	hostKey(key, sizeof(key), mode);
+	return loadSettingsBlob(key, &host, sizeof(host)) && host.valid;
+}
+
+static inline bool sameAddress(const uint8_t* a, const uint8_t* b){
+	return memcmp(a, b, 6) == 0;
+}
+
+// Table lookups; callers hold bleMux
+static int findHostByConnId(uint16_t connId){
+	for (int i = 0; i < MAX_BLE_HOSTS; i++) {
+		if (bleHosts[i].inUse && bleHosts[i].connId == connId) return i;
+	}
+	return -1;
+}
+
+static int findHostByAddress(const uint8_t* address){
+	for (int i = 0; i < MAX_BLE_HOSTS; i++) {
+		if (bleHosts[i].inUse && sameAddress(bleHosts[i].address, address)) return i;
+	}
+	return -1;
+}
+
+static uint8_t connectedHostCount(){
+	uint8_t count = 0;
+	for (int i = 0; i < MAX_BLE_HOSTS; i++) {
+		if (bleHosts[i].inUse) count++;
+	}
+	return count;
+}
+
+// BLE_REPORT for a characteristic handle; -1 for anything else
+static int reportForHandle(uint16_t handle){
+	for (int report = 0; report < NUM_BLE_REPORTS; report++) {
+		if (handle != 0 && reportHandles[report] == handle) return report;
+	}
+	return -1;
+}
+
+// Reports are full state snapshots, so a state that hasn't gone out yet is simply replaced; the
+// host skips the intermediate states and still ends up with the right one
+static void markPending(BleHost& host, uint8_t reports){
+	if (host.pending & reports) host.merged++;
+	else if (!host.pending) host.pendingSince = micros();
+	host.pending |= reports;
+}
+
+static void queueReport(BleHost& host, const NkroReport& report){
+	host.report = report;
+	markPending(host, BLE_REPORT_BIT(BLE_REPORT_KEYBOARD));
+}
+
+static void queuePadReport(BleHost& host, const PadReport& report){
+	host.padReport = report;
+	markPending(host, BLE_REPORT_BIT(BLE_REPORT_GAMEPAD));
+}
+
+// Sends the host's latest state while the link has a free buffer. Both tasks call this; whoever
+// finds a send already under way leaves it to the other, and the system task picks up the rest
+static void sendLatestReport(int index){
+	BleHost& host = bleHosts[index];
+	portENTER_CRITICAL(&bleMux);
+	if (host.sending) {
+		portEXIT_CRITICAL(&bleMux);
+		return;
+	}
+	host.sending = true;
+	portEXIT_CRITICAL(&bleMux);
+
+	while (true) {
+		union {
+			NkroReport keys;
+			PadReport pad;
+		} data;
+		uint16_t length = 0;
+		uint16_t handle = 0;
+		uint8_t reportBit = 0;
+		uint16_t connId = 0;
+		uint32_t since = 0;
+		portENTER_CRITICAL(&bleMux);
+		// Keys first: a flipper edge matters more than an axis a millisecond later
+		int report = (host.pending & BLE_REPORT_BIT(BLE_REPORT_KEYBOARD)) ? BLE_REPORT_KEYBOARD : BLE_REPORT_GAMEPAD;
+		bool ready = host.inUse && host.pending && !host.congested && host.inFlight < MAX_REPORTS_IN_FLIGHT
+			&& reportHandles[report] != 0;
+		if (ready) {
+			if (report == BLE_REPORT_KEYBOARD) {
+				data.keys = host.report;
+				length = sizeof(NkroReport);
+			} else {
+				data.pad = host.padReport;
+				length = sizeof(PadReport);
+			}
+			handle = reportHandles[report];
+			reportBit = BLE_REPORT_BIT(report);
+			connId = host.connId;
+			since = host.pendingSince;
+			host.pending &= ~reportBit;
+			// Counted before the send, so a confirmation racing back on the other core finds it
+			if (host.inFlight++ == 0) host.confWaitSince = micros();
+		}
+		portEXIT_CRITICAL(&bleMux);
+		if (!ready) break;
+
+		esp_err_t result = esp_ble_gatts_send_indicate(gattsInterface, connId, handle, length, (uint8_t*)&data, false);
+		uint32_t now = micros();
+
+		portENTER_CRITICAL(&bleMux);
+		bool sameLink = host.inUse && host.connId == connId;
+		if (sameLink && result == ESP_OK) {
+			host.sent++;
+			if (now - since > host.maxWaitUs) host.maxWaitUs = now - since;
+		} else if (sameLink) {
+			if (host.inFlight > 0) host.inFlight--;
+			// Not taken; unless a newer state came in meanwhile, this one is still the one to send
+			if (!(host.pending & reportBit)) {
+				if (!host.pending) host.pendingSince = since;
+				host.pending |= reportBit;
+			}
+		}
+		portEXIT_CRITICAL(&bleMux);
+		if (result != ESP_OK) break;
+	}
+
+	portENTER_CRITICAL(&bleMux);
+	host.sending = false;
+	portEXIT_CRITICAL(&bleMux);
+}
+
+// A failed or lost notification may have carried the state the host is missing, so the latest
+// one of each report it could have been goes out again
+static void resendAfterDrop(BleHost& host, uint8_t reports){
+	host.dropped++;
+	if (!host.pending) host.pendingSince = micros();
+	host.pending |= reports;
+}
+
+// The old host gets an all-released report so nothing stays held there; the new one gets the current state
+static void setActiveHost(int index){
+	portENTER_CRITICAL(&bleMux);
+	int previous = activeHost;
+	if (previous == index) {
+		portEXIT_CRITICAL(&bleMux);
+		return;
+	}
+	if (previous >= 0) {
+		queueReport(bleHosts[previous], emptyReport);
+		queuePadReport(bleHosts[previous], emptyPadReport);
+	}
+	activeHost = index;
+	if (index >= 0) {
+		queueReport(bleHosts[index], activeReport);
+		queuePadReport(bleHosts[index], activePadReport);
+	}
+	portEXIT_CRITICAL(&bleMux);
+
+	if (previous >= 0) sendLatestReport(previous);
+	if (index >= 0) sendLatestReport(index);
+}
+
+// A profile remembers the bonded host it was last used with
+static void rememberProfileHost(int index){
+	BondedHost host;
+	portENTER_CRITICAL(&bleMux);
+	memcpy(host.address, bleHosts[index].address, sizeof(host.address));
+	host.addressType = bleHosts[index].addressType;
+	host.valid = bleHosts[index].bonded;
+	portEXIT_CRITICAL(&bleMux);
+	if (!host.valid) return;
+	if (profileHost.valid && sameAddress(profileHost.address, host.address)) return;
+
+	profileHost = host;
+	char key[8];
+	hostKey(key, sizeof(key), currentGameMode);
+	saveSettingsBlob(key, &host, sizeof(host));
+}
+
+static void gapHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param){
+	if (event == ESP_GAP_BLE_AUTH_CMPL_EVT && param->ble_security.auth_cmpl.success) {
+		portENTER_CRITICAL(&bleMux);
+		// A host using a resolvable private address bonds under its identity address; pin that
+		// to the link that just came up so directed advertising targets the right address later
+		int index = findHostByAddress(param->ble_security.auth_cmpl.bd_addr);
+		if (index < 0) index = lastConnectedHost;
+		if (index >= 0 && bleHosts[index].inUse) {
+			memcpy(bleHosts[index].address, param->ble_security.auth_cmpl.bd_addr, sizeof(bleHosts[index].address));
+			bleHosts[index].addressType = param->ble_security.auth_cmpl.addr_type;
+			bleHosts[index].bonded = true;
+			bondPending = true;
+		}
+		portEXIT_CRITICAL(&bleMux);
+	} else if (event == ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT && param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+		portENTER_CRITICAL(&bleMux);
+		int index = findHostByAddress(param->update_conn_params.bda);
+		if (index >= 0) bleHosts[index].connInterval = param->update_conn_params.conn_int;
+		portEXIT_CRITICAL(&bleMux);
+	}
+}
+
+static void gattsHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t* param){
+	if (event == ESP_GATTS_CONNECT_EVT) {
+		uint32_t elapsedMs = (micros() - outageStart) / 1000;
+		int index = -1;
+		portENTER_CRITICAL(&bleMux);
+		gattsInterface = gattsIf;
+		// The outage is only over for a link that restores input: the first one after none, or the
+		// profile's own host coming back. A second host joining while one is up is not a reconnect
+		bool anyConnected = false;
+		for (int i = 0; i < MAX_BLE_HOSTS; i++) {
+			if (bleHosts[i].inUse) anyConnected = true;
+		}
+		bool bondedHost = profileHost.valid && sameAddress(param->connect.remote_bda, profileHost.address);
+		if (!anyConnected || bondedHost) {
+			ReconnectStats& stats = reconnectStats;
+			stats.count++;
+			if (reconnectState == RECONNECT_DIRECTED) stats.directedCount++;
+			stats.lastMs = elapsedMs;
+			stats.totalMs += elapsedMs;
+			if (elapsedMs < stats.minMs) stats.minMs = elapsedMs;
+			if (elapsedMs > stats.maxMs) stats.maxMs = elapsedMs;
+		}
+		for (int i = 0; i < MAX_BLE_HOSTS; i++) {
+			if (bleHosts[i].inUse) continue;
+			BleHost& host = bleHosts[i];
+			memcpy(host.address, param->connect.remote_bda, sizeof(host.address));
+			host.addressType = BLE_ADDR_TYPE_PUBLIC;
+			host.inUse = true;
+			host.fresh = true;
+			host.bonded = false;
+			host.congested = false;
+			host.sending = false;
+			host.pending = 0;
+			host.inFlight = 0;
+			host.connId = param->connect.conn_id;
+			host.connInterval = param->connect.conn_params.interval;
+			host.sent = 0;
+			host.merged = 0;
+			host.dropped = 0;
+			host.maxWaitUs = 0;
+			index = i;
+			break;
+		}
+		lastConnectedHost = index;
+		portEXIT_CRITICAL(&bleMux);
+		// Advertising stops once the table is full, so this only happens if a link raced in
+		if (index < 0) esp_ble_gatts_close(gattsIf, param->connect.conn_id);
+	} else if (event == ESP_GATTS_DISCONNECT_EVT) {
+		portENTER_CRITICAL(&bleMux);
+		int index = findHostByConnId(param->disconnect.conn_id);
+		if (index >= 0) {
+			bleHosts[index].inUse = false;
+			bleHosts[index].pending = 0;
+			bleHosts[index].inFlight = 0;
+			if (activeHost == index) activeHost = -1;
+		}
+		outageStart = micros();
+		linkDropped = true;
+		portEXIT_CRITICAL(&bleMux);
+	} else if (event == ESP_GATTS_CONGEST_EVT) {
+		// Holds every send until the link drains; the latest state waits in the slot meanwhile.
+		// Confirmations stop while congested, so their timeout starts over when it clears
+		portENTER_CRITICAL(&bleMux);
+		int index = findHostByConnId(param->congest.conn_id);
+		if (index >= 0) {
+			bleHosts[index].congested = param->congest.congested;
+			if (!param->congest.congested) bleHosts[index].confWaitSince = micros();
+		}
+		portEXIT_CRITICAL(&bleMux);
+	} else if (event == ESP_GATTS_CONF_EVT && reportForHandle(param->conf.handle) >= 0) {
+		// Notifications get one too, once the stack has queued them for the controller (not when the
+		// host has them); that frees a buffer. The next state goes out from serviceBleConnection()
+		// rather than from the Bluetooth task itself. ESP_GATT_CONGESTED still means queued, just
+		// that the link is now full: CONGEST_EVT holds the sends, nothing was lost
+		portENTER_CRITICAL(&bleMux);
+		int index = findHostByConnId(param->conf.conn_id);
+		if (index >= 0 && bleHosts[index].inFlight > 0) {
+			BleHost& host = bleHosts[index];
+			host.inFlight--;
+			host.confWaitSince = micros();
+			if (param->conf.status != ESP_GATT_OK && param->conf.status != ESP_GATT_CONGESTED) {
+				resendAfterDrop(host, BLE_REPORT_BIT(reportForHandle(param->conf.handle)));
+			}
+		}
+		portEXIT_CRITICAL(&bleMux);
+	}
+}
+
+static void startDirectedAdvertising(const BondedHost& host){
+	esp_ble_adv_params_t params;
+	memset(&params, 0, sizeof(params));
+	params.adv_int_min = DIRECTED_ADV_INTERVAL;
+	params.adv_int_max = DIRECTED_ADV_INTERVAL;
+	params.adv_type = ADV_TYPE_DIRECT_IND_HIGH;
+	params.own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+	memcpy(params.peer_addr, host.address, sizeof(params.peer_addr));
+	params.peer_addr_type = (esp_ble_addr_type_t)host.addressType;
+	params.channel_map = ADV_CHNL_ALL;
+	params.adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+
+	esp_ble_gap_stop_advertising();
+	esp_ble_gap_start_advertising(&params);
+}
+
+// Hooks the stack's GAP/GATTS events; must run before keyboard.begin()
+void bleConnectionBegin(){
+	BLEDevice::setCustomGapHandler(gapHandler);
+	BLEDevice::setCustomGattsHandler(gattsHandler);
+}
+
+void bleSetReportHandles(uint16_t keyboardHandle, uint16_t gamepadHandle){
+	reportHandles[BLE_REPORT_KEYBOARD] = keyboardHandle;
+	reportHandles[BLE_REPORT_GAMEPAD] = gamepadHandle;
+}
+
+void bleQueueReport(const NkroReport& report){
+	portENTER_CRITICAL(&bleMux);
+	activeReport = report;
+	int index = activeHost;
+	if (index >= 0) queueReport(bleHosts[index], report);
+	portEXIT_CRITICAL(&bleMux);
+	if (index >= 0) sendLatestReport(index);
+}
+
+void bleQueuePadReport(const PadReport& report){
+	portENTER_CRITICAL(&bleMux);
+	activePadReport = report;
+	int index = activeHost;
+	if (index >= 0) queuePadReport(bleHosts[index], report);
+	portEXIT_CRITICAL(&bleMux);
+	if (index >= 0) sendLatestReport(index);
+}
+
+bool bleHostConnected(){
+	return activeHost >= 0;
+}
+
+uint32_t bleReportIntervalUs(){
+	int index = activeHost;
+	return (index >= 0) ? bleHosts[index].connInterval * 1250UL : 0;
+}
+
+bool switchActiveHost(int index){
+	portENTER_CRITICAL(&bleMux);
+	if (index < 0) {
+		for (int step = 1; step <= MAX_BLE_HOSTS; step++) {
+			int candidate = (activeHost + step + MAX_BLE_HOSTS) % MAX_BLE_HOSTS;
+			if (bleHosts[candidate].inUse) {
+				index = candidate;
+				break;
+			}
+		}
+	}
+	bool valid = index >= 0 && index < MAX_BLE_HOSTS && bleHosts[index].inUse;
+	portEXIT_CRITICAL(&bleMux);
+	if (!valid) return false;
+
+	// Also reached from a button on the input task, so the message waits for serviceBleConnection()
+	setActiveHost(index);
+	profileHostPending = index;
+	return true;
+}
+
+// Called when the game profile changes: route to that profile's host if it is connected
+void bleProfileChanged(){
+	if (!loadBondedHost(currentGameMode, profileHost)) profileHost.valid = 0;
+	if (!profileHost.valid) return;
+	portENTER_CRITICAL(&bleMux);
+	int index = findHostByAddress(profileHost.address);
+	portEXIT_CRITICAL(&bleMux);
+	if (index >= 0) setActiveHost(index);
+}
+
+void serviceBleConnection(){
+	// New links become active when nothing else is, or when they are the profile's host
+	bool hostJoined = false;
+	for (int i = 0; i < MAX_BLE_HOSTS; i++) {
+		portENTER_CRITICAL(&bleMux);
+		bool fresh = bleHosts[i].fresh;
+		bleHosts[i].fresh = false;
+		bool preferred = profileHost.valid && sameAddress(bleHosts[i].address, profileHost.address);
+		int current = activeHost;
+		portEXIT_CRITICAL(&bleMux);
+		if (!fresh) continue;
+		hostJoined = true;
+		if (current < 0 || preferred) setActiveHost(i);
+	}
+
+	// The active host dropped; fall over to whichever one is left
+	if (activeHost < 0) {
+		for (int i = 0; i < MAX_BLE_HOSTS; i++) {
+			if (bleHosts[i].inUse) {
+				setActiveHost(i);
+				break;
+			}
+		}
+	}
+
+	int switchedHost = profileHostPending;
+	if (switchedHost >= 0) {
+		profileHostPending = -1;
+		Serial.printf("Active host: %d\n", switchedHost);
+		rememberProfileHost(switchedHost);
+	}
+
+	if (bondPending) {
+		bondPending = false;
+		int index = activeHost;
+		if (index >= 0) rememberProfileHost(index);
+	}
+
+	// Waiting states go out here once a confirmation or the end of congestion frees a buffer
+	for (int i = 0; i < MAX_BLE_HOSTS; i++) {
+		BleHost& host = bleHosts[i];
+		portENTER_CRITICAL(&bleMux);
+		uint32_t now = micros();
+		if (host.inUse && host.inFlight > 0 && !host.congested
+				&& now - host.confWaitSince > REPORT_CONF_TIMEOUT_MS * 1000UL) {
+			host.inFlight = 0;
+			resendAfterDrop(host, ALL_BLE_REPORTS);
+		}
+		bool pending = host.pending;
+		portEXIT_CRITICAL(&bleMux);
+		if (pending) sendLatestReport(i);
+	}
+
+	if (linkDropped) {
+		linkDropped = false;
+		reconnectState = RECONNECT_PENDING;
+	}
+
+	portENTER_CRITICAL(&bleMux);
+	bool tableFull = connectedHostCount() == MAX_BLE_HOSTS;
+	bool profileHostConnected = profileHost.valid && findHostByAddress(profileHost.address) >= 0;
+	portEXIT_CRITICAL(&bleMux);
+
+	switch (reconnectState) {
+		case RECONNECT_PENDING:
+			if (tableFull) {
+				reconnectState = RECONNECT_IDLE;
+			} else if (profileHost.valid && !profileHostConnected) {
+				startDirectedAdvertising(profileHost);
+				directedStart = millis();
+				reconnectState = RECONNECT_DIRECTED;
+			} else {
+				BLEDevice::getAdvertising()->start();
+				reconnectState = RECONNECT_IDLE;
+			}
+			break;
+		case RECONNECT_DIRECTED:
+			if (hostJoined || millis() - directedStart >= DIRECTED_ADV_WINDOW_MS) {
+				esp_ble_gap_stop_advertising();
+				if (!tableFull) BLEDevice::getAdvertising()->start();
+				reconnectState = RECONNECT_IDLE;
+			}
+			break;
+		case RECONNECT_IDLE:
+			// A connection stops advertising; keep it going while another host can still join
+			if (hostJoined && !tableFull) BLEDevice::getAdvertising()->start();
+			break;
+	}
+}
+
+static void printHosts(){
+	for (int i = 0; i < MAX_BLE_HOSTS; i++) {
+		BleHost host;
+		portENTER_CRITICAL(&bleMux);
+		host = bleHosts[i];
+		portEXIT_CRITICAL(&bleMux);
+		if (!host.inUse) {
+			Serial.printf("  %d: free\n", i);
+			continue;
+		}
+		Serial.printf("%c %d: %02X:%02X:%02X:%02X:%02X:%02X%s%s, %u in flight%s\n",
+			(i == activeHost) ? '*' : ' ', i, host.address[0], host.address[1], host.address[2],
+			host.address[3], host.address[4], host.address[5], host.bonded ? " bonded" : "",
+			host.congested ? " congested" : "", host.inFlight, host.pending ? ", state waiting" : "");
+		Serial.printf("     interval %u us, %u sent, %u merged, %u dropped, max wait %u us\n",
+			host.connInterval * 1250, host.sent, host.merged, host.dropped, host.maxWaitUs);
+	}
+}
+
+// ble                 hosts, this profile's bonded host and reconnect statistics
+// ble host [<n>]      switch reports to host n, or to the next connected one
+// ble forget          drop this profile's bonded host
+void bleCommand(const char* args){
+	char key[8];
+	hostKey(key, sizeof(key), currentGameMode);
+	if (strcmp(args, "forget") == 0) {
+		eraseSettingsBlob(key);
+		profileHost.valid = 0;
+		Serial.println("Bonded host forgotten; advertising undirected on next reconnect");
+		return;
+	}
+	if (strncmp(args, "host", 4) == 0) {
+		int index = (args[4] == ' ') ? atoi(args + 5) : -1;
+		if (!switchActiveHost(index)) Serial.println("No such host connected");
+		return;
+	}
+
+	printHosts();
+	BondedHost host;
+	if (loadBondedHost(currentGameMode, host)) {
+		Serial.printf("Bonded host: %02X:%02X:%02X:%02X:%02X:%02X (type %u)\n", host.address[0], host.address[1],
+			host.address[2], host.address[3], host.address[4], host.address[5], host.addressType);
+	} else {
+		Serial.println("Bonded host: none for this profile");
+	}
+
+	ReconnectStats stats;
+	portENTER_CRITICAL(&bleMux);
+	stats = reconnectStats;
+	portEXIT_CRITICAL(&bleMux);
+	Serial.printf("%u of %u hosts connected, %u connects (%u via directed advertising)\n",
+		connectedHostCount(), MAX_BLE_HOSTS, stats.count, stats.directedCount);
+	if (stats.count > 0) {
+		Serial.printf("Reconnect ms: last %u, min %u, avg %u, max %u\n",
+			stats.lastMs, stats.minMs, (uint32_t)(stats.totalMs / stats.count), stats.maxMs);
+	}
+}
+
+#else
+
+void bleCommand(const char* args){
+	Serial.println("BLE output disabled; this build uses another output backend");
+}
+
+#endif
@@ -0,0 +1,243 @@
+#include "hidOutput.hpp"
+
+#ifdef OUTPUT_BACKEND_BLE
+
+#include "bleHidKeyboard.hpp"
+#include "bleConnectionManager.hpp"
+
+#define SHIFT 0x80
+
+// NKRO keyboard: modifiers, 5 LEDs out, then a bitmap of usages 0-127.
+// Gamepad: 32 buttons, then Z and the two triggers as Rx/Ry like the USB gamepad
+static const uint8_t reportMap[] = {
+	0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)
+	0x09, 0x06,                    // USAGE (Keyboard)
+	0xA1, 0x01,                    // COLLECTION (Application)
+	0x85, KEYBOARD_REPORT_ID,      //   REPORT_ID
+	0x05, 0x07,                    //   USAGE_PAGE (Keyboard)
+	0x19, 0xE0,                    //   USAGE_MINIMUM (Left Control)
+	0x29, 0xE7,                    //   USAGE_MAXIMUM (Right GUI)
+	0x15, 0x00,                    //   LOGICAL_MINIMUM (0)
+	0x25, 0x01,                    //   LOGICAL_MAXIMUM (1)
+	0x75, 0x01,                    //   REPORT_SIZE (1)
+	0x95, 0x08,                    //   REPORT_COUNT (8)
+	0x81, 0x02,                    //   INPUT (Data,Var,Abs) modifiers
+	0x95, 0x05,                    //   REPORT_COUNT (5)
+	0x75, 0x01,                    //   REPORT_SIZE (1)
+	0x05, 0x08,                    //   USAGE_PAGE (LEDs)
+	0x19, 0x01,                    //   USAGE_MINIMUM (Num Lock)
+	0x29, 0x05,                    //   USAGE_MAXIMUM (Kana)
+	0x91, 0x02,                    //   OUTPUT (Data,Var,Abs) LEDs
+	0x95, 0x01,                    //   REPORT_COUNT (1)
+	0x75, 0x03,                    //   REPORT_SIZE (3)
+	0x91, 0x01,                    //   OUTPUT (Cnst) padding
+	0x95, NKRO_USAGE_COUNT,        //   REPORT_COUNT (128)
+	0x75, 0x01,                    //   REPORT_SIZE (1)
+	0x05, 0x07,                    //   USAGE_PAGE (Keyboard)
+	0x19, 0x00,                    //   USAGE_MINIMUM (0)
+	0x29, NKRO_USAGE_COUNT - 1,    //   USAGE_MAXIMUM (127)
+	0x81, 0x02,                    //   INPUT (Data,Var,Abs) key bitmap
+	0xC0,                          // END_COLLECTION
+	0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)
+	0x09, 0x05,                    // USAGE (Game Pad)
+	0xA1, 0x01,                    // COLLECTION (Application)
+	0x85, GAMEPAD_REPORT_ID,       //   REPORT_ID
+	0x05, 0x09,                    //   USAGE_PAGE (Button)
+	0x19, 0x01,                    //   USAGE_MINIMUM (Button 1)
+	0x29, NUM_PAD_BUTTONS,         //   USAGE_MAXIMUM (Button 32)
+	0x15, 0x00,                    //   LOGICAL_MINIMUM (0)
+	0x25, 0x01,                    //   LOGICAL_MAXIMUM (1)
+	0x75, 0x01,                    //   REPORT_SIZE (1)
+	0x95, NUM_PAD_BUTTONS,         //   REPORT_COUNT (32)
+	0x81, 0x02,                    //   INPUT (Data,Var,Abs) buttons
+	0x05, 0x01,                    //   USAGE_PAGE (Generic Desktop)
+	0x09, 0x32,                    //   USAGE (Z) plunger
+	0x09, 0x33,                    //   USAGE (Rx) left trigger
+	0x09, 0x34,                    //   USAGE (Ry) right trigger
+	0x15, 0x81,                    //   LOGICAL_MINIMUM (-127)
+	0x25, 0x7F,                    //   LOGICAL_MAXIMUM (127)
+	0x75, 0x08,                    //   REPORT_SIZE (8)
+	0x95, NUM_PAD_AXES,            //   REPORT_COUNT (3)
+	0x81, 0x02,                    //   INPUT (Data,Var,Abs) axes
+	0xC0                           // END_COLLECTION
+};
+
+// US layout usage for a printable character, with SHIFT set when it needs the shift modifier
+static uint8_t asciiUsage(uint8_t c){
+	if (c >= 'a' && c <= 'z') return 0x04 + (c - 'a');
+	if (c >= 'A' && c <= 'Z') return (0x04 + (c - 'A')) | SHIFT;
+	if (c >= '1' && c <= '9') return 0x1E + (c - '1');
+	switch (c) {
+		case '0':  return 0x27;
+		case '\n': return 0x28;
+		case '\b': return 0x2A;
+		case '\t': return 0x2B;
+		case ' ':  return 0x2C;
+		case '!':  return 0x1E | SHIFT;
+		case '@':  return 0x1F | SHIFT;
+		case '#':  return 0x20 | SHIFT;
+		case '$':  return 0x21 | SHIFT;
+		case '%':  return 0x22 | SHIFT;
+		case '^':  return 0x23 | SHIFT;
+		case '&':  return 0x24 | SHIFT;
+		case '*':  return 0x25 | SHIFT;
+		case '(':  return 0x26 | SHIFT;
+		case ')':  return 0x27 | SHIFT;
+		case '-':  return 0x2D;
+		case '_':  return 0x2D | SHIFT;
+		case '=':  return 0x2E;
+		case '+':  return 0x2E | SHIFT;
+		case '[':  return 0x2F;
+		case '{':  return 0x2F | SHIFT;
+		case ']':  return 0x30;
+		case '}':  return 0x30 | SHIFT;
+		case '\\': return 0x31;
+		case '|':  return 0x31 | SHIFT;
+		case ';':  return 0x33;
+		case ':':  return 0x33 | SHIFT;
+		case '\'': return 0x34;
+		case '"':  return 0x34 | SHIFT;
+		case '`':  return 0x35;
+		case '~':  return 0x35 | SHIFT;
+		case ',':  return 0x36;
+		case '<':  return 0x36 | SHIFT;
+		case '.':  return 0x37;
+		case '>':  return 0x37 | SHIFT;
+		case '/':  return 0x38;
+		case '?':  return 0x38 | SHIFT;
+		default:   return 0;
+	}
+}
+
+// Same key code convention as BleKeyboard: 0x80-0x87 are modifiers, 0x88+ are raw usages + 136,
+// everything below is ASCII. Returns the usage (0 for a bare modifier) and sets the modifier bits
+static bool resolveKey(uint8_t k, uint8_t& usage, uint8_t& modifiers){
+	modifiers = 0;
+	if (k >= 136) {
+		usage = k - 136;
+	} else if (k >= 128) {
+		usage = 0;
+		modifiers = 1 << (k - 128);
+	} else {
+		usage = asciiUsage(k);
+		if (!usage) return false;
+		if (usage & SHIFT) {
+			modifiers = 0x02;
+			usage &= ~SHIFT;
+		}
+	}
+	return true;
+}
+
+BleHidKeyboard::BleHidKeyboard(const char* deviceName, const char* manufacturer, uint8_t batteryLevel)
+	: deviceName(deviceName), manufacturer(manufacturer), batteryLevel(batteryLevel),
+	  hid(nullptr), inputKeyboard(nullptr), outputKeyboard(nullptr), inputGamepad(nullptr) {
+	memset(&keyReport, 0, sizeof(keyReport));
+	memset(modifierCounts, 0, sizeof(modifierCounts));
+	memset(&padReport, 0, sizeof(padReport));
+	for (uint16_t k = 0; k < 256; k++) {
+		uint8_t usage, modifiers;
+		KeyMask& mask = keyMasks[k];
+		if (!resolveKey(k, usage, modifiers)) {
+			mask = {0, 0, 0};
+			continue;
+		}
+		mask.byte = usage / 8;
+		mask.bit = usage ? 1 << (usage % 8) : 0;
+		mask.modifiers = modifiers;
+	}
+}
+
+// Same vendor/product IDs and security setup as BleKeyboard; the media key report is replaced by
+// the gamepad. A host bonded before the gamepad was added caches the old report map and has to
+// forget the device and pair again
+void BleHidKeyboard::begin(){
+	BLEDevice::init(deviceName);
+	BLEServer* server = BLEDevice::createServer();
+
+	hid = new BLEHIDDevice(server);
+	inputKeyboard = hid->inputReport(KEYBOARD_REPORT_ID);
+	outputKeyboard = hid->outputReport(KEYBOARD_REPORT_ID);
+	inputGamepad = hid->inputReport(GAMEPAD_REPORT_ID);
+	hid->manufacturer()->setValue(manufacturer);
+	hid->pnp(0x02, 0x05ac, 0x820a, 0x0210);
+	hid->hidInfo(0x00, 0x01);
+
+	BLESecurity* security = new BLESecurity();
+	security->setAuthenticationMode(ESP_LE_AUTH_BOND);
+
+	hid->reportMap((uint8_t*)reportMap, sizeof(reportMap));
+	hid->startServices();
+	hid->setBatteryLevel(batteryLevel);
+	bleSetReportHandles(inputKeyboard->getHandle(), inputGamepad->getHandle());
+
+	BLEAdvertising* advertising = server->getAdvertising();
+	advertising->setAppearance(HID_KEYBOARD);
+	advertising->addServiceUUID(hid->hidService()->getUUID());
+	advertising->setScanResponse(false);
+	advertising->start();
+}
+
+// The arbiter sends one press and one release per key code, but different codes can need the same
+// modifier ('A' and KEY_LEFT_SHIFT); a modifier bit goes up with the last key that needs it
+size_t BleHidKeyboard::press(uint8_t k){
+	const KeyMask& mask = keyMasks[k];
+	if (!mask.bit && !mask.modifiers) return 0;
+	keyReport.keys[mask.byte] |= mask.bit;
+	for (uint8_t modifier = 0; modifier < 8; modifier++) {
+		if (mask.modifiers & (1 << modifier)) modifierCounts[modifier]++;
+	}
+	keyReport.modifiers |= mask.modifiers;
+	sendReport(&keyReport);
+	return 1;
+}
+
+size_t BleHidKeyboard::release(uint8_t k){
+	const KeyMask& mask = keyMasks[k];
+	if (!mask.bit && !mask.modifiers) return 0;
+	keyReport.keys[mask.byte] &= ~mask.bit;
+	for (uint8_t modifier = 0; modifier < 8; modifier++) {
+		if (!(mask.modifiers & (1 << modifier)) || modifierCounts[modifier] == 0) continue;
+		if (--modifierCounts[modifier] == 0) keyReport.modifiers &= ~(1 << modifier);
+	}
+	sendReport(&keyReport);
+	return 1;
+}
+
+void BleHidKeyboard::releaseAll(){
+	memset(&keyReport, 0, sizeof(keyReport));
+	memset(modifierCounts, 0, sizeof(modifierCounts));
+	sendReport(&keyReport);
+	// Centres the axes too, like the USB backend's release
+	memset(&padReport, 0, sizeof(padReport));
+	bleQueuePadReport(padReport);
+}
+
+// Buttons are 1-based like the USB gamepad
+void BleHidKeyboard::padPress(uint8_t button){
+	if (button < 1 || button > NUM_PAD_BUTTONS) return;
+	padReport.buttons |= 1UL << (button - 1);
+	bleQueuePadReport(padReport);
+}
+
+void BleHidKeyboard::padRelease(uint8_t button){
+	if (button < 1 || button > NUM_PAD_BUTTONS) return;
+	padReport.buttons &= ~(1UL << (button - 1));
+	bleQueuePadReport(padReport);
+}
+
+// Every axis lands in the same report, so a plunger and trigger move on one scan is one notification
+void BleHidKeyboard::setAxes(const int8_t values[NUM_PAD_AXES]){
+	memcpy(padReport.axes, values, sizeof(padReport.axes));
+	bleQueuePadReport(padReport);
+}
+
+bool BleHidKeyboard::isConnected(){
+	return bleHostConnected();
+}
+
+void BleHidKeyboard::sendReport(NkroReport* report){
+	bleQueueReport(*report);
+}
+
+#endif
@@ -0,0 +1,176 @@
+#include "directInputs.hpp"
+#include "arcadeButtonProcessor.hpp"
+
+#ifdef DIRECT_INPUTS
+
+#include "eventBus.hpp"
+#include <soc/gpio_reg.h>
+
+struct DirectInput {
+	int8_t pin;
+	uint8_t bit;
+};
+
+// In DRAM so the edge interrupt can read it while the flash cache is off
+static const DirectInput DRAM_ATTR directInputs[] = {
+	{DIRECT_PIN_LFLIPPER,   BTN_BIT_LFLIPPER},
+	{DIRECT_PIN_RFLIPPER,   BTN_BIT_RFLIPPER},
+	{DIRECT_PIN_LMAGNASAVE, BTN_BIT_LMAGNASAVE},
+	{DIRECT_PIN_RMAGNASAVE, BTN_BIT_RMAGNASAVE}
+};
+
+#define NUM_DIRECT_INPUTS  (sizeof(directInputs) / sizeof(DirectInput))
+
+static uint8_t directMask = 0;
+static uint8_t directLevels = 0xFF;
+
+static uint8_t readDirectLevels(){
+	uint8_t levels = 0xFF;
+	for (uint8_t i = 0; i < NUM_DIRECT_INPUTS; i++) {
+		if (directInputs[i].pin >= 0 && !digitalRead(directInputs[i].pin)) levels &= ~(1 << directInputs[i].bit);
+	}
+	return levels;
+}
+
+#ifdef DIRECT_INPUTS_PCNT
+
+#include <driver/pcnt.h>
+
+// One counter unit per pin, counting both edges
+static int16_t lastCount[NUM_DIRECT_INPUTS];
+static uint32_t edgeCounts[NUM_DIRECT_INPUTS];
+static uint32_t bounceCounts[NUM_DIRECT_INPUTS];
+
+void directInputsBegin(){
+	for (uint8_t i = 0; i < NUM_DIRECT_INPUTS; i++) {
+		if (directInputs[i].pin < 0) continue;
+		pinMode(directInputs[i].pin, INPUT_PULLUP);
+
+		pcnt_config_t config = {};
+		config.pulse_gpio_num = directInputs[i].pin;
+		config.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+		config.channel = PCNT_CHANNEL_0;
+		config.unit = (pcnt_unit_t)i;
+		config.pos_mode = PCNT_COUNT_INC;
+		config.neg_mode = PCNT_COUNT_INC;
+		config.lctrl_mode = PCNT_MODE_KEEP;
+		config.hctrl_mode = PCNT_MODE_KEEP;
+		config.counter_h_lim = PCNT_COUNT_LIMIT;
+		config.counter_l_lim = 0;
+		if (pcnt_unit_config(&config) != ESP_OK) {
+			Serial.printf("PCNT setup failed for GPIO %d\n", directInputs[i].pin);
+			continue;
+		}
+		pcnt_set_filter_value(config.unit, PCNT_FILTER_TICKS);
+		pcnt_filter_enable(config.unit);
+		pcnt_counter_pause(config.unit);
+		pcnt_counter_clear(config.unit);
+		pcnt_counter_resume(config.unit);
+		lastCount[i] = 0;
+		directMask |= (1 << directInputs[i].bit);
+	}
+	directLevels = readDirectLevels();
+}
+
+// Any count since the last scan means the switch moved: its debounce timer restarts now. Of the
+// edges counted, at most one explains a change of level; the rest are bounce
+InputWord applyDirectInputs(InputWord raw){
+	unsigned long now = millis();
+	uint8_t levels = readDirectLevels();
+	for (uint8_t i = 0; i < NUM_DIRECT_INPUTS; i++) {
+		if (!(directMask & (1 << directInputs[i].bit))) continue;
+		int16_t count;
+		pcnt_get_counter_value((pcnt_unit_t)i, &count);
+		int32_t edges = count - lastCount[i];
+		if (edges < 0) edges += PCNT_COUNT_LIMIT;
+		lastCount[i] = count;
+		if (edges == 0) continue;
+
+		uint8_t bit = directInputs[i].bit;
+		bool levelChanged = (levels ^ directLevels) & (1 << bit);
+		edgeCounts[i] += edges;
+		bounceCounts[i] += edges - (levelChanged ? 1 : 0);
+		noteInputEdge(bit, (levels >> bit) & 1, now);
+	}
+	directLevels = levels;
+	return (raw & ~(InputWord)directMask) | (directLevels & directMask);
+}
+
+// "direct" shows each pin's edge and bounce counts
+void directCommand(const char* args){
+	for (uint8_t i = 0; i < NUM_DIRECT_INPUTS; i++) {
+		if (!(directMask & (1 << directInputs[i].bit))) continue;
+		Serial.printf("GPIO %2d bit %u: %s, %u edges, %u bounces\n", directInputs[i].pin, directInputs[i].bit,
+			(directLevels & (1 << directInputs[i].bit)) ? "released" : "pressed", edgeCounts[i], bounceCounts[i]);
+	}
+}
+
+#else
+
+static EventQueue<InputEdge, DIRECT_EDGE_QUEUE_LENGTH> edgeQueue;
+static volatile uint32_t edgeCounts[NUM_DIRECT_INPUTS];
+static uint32_t lastDropped = 0;
+
+// digitalRead() lives in flash; the input registers are always there. GPIO0-31 are in GPIO_IN_REG,
+// GPIO32-39 in GPIO_IN1_REG
+static inline uint8_t IRAM_ATTR readPinLevel(int8_t pin){
+	return (pin < 32) ? (REG_READ(GPIO_IN_REG) >> pin) & 1 : (REG_READ(GPIO_IN1_REG) >> (pin - 32)) & 1;
+}
+
+// Everything it touches is in IRAM or DRAM (micros() is IRAM_ATTR in the core, EventQueue::push
+// too), so an edge during a flash write is still taken
+static void IRAM_ATTR directInputISR(void* arg){
+	uint32_t index = (uintptr_t)arg;
+	InputEdge edge = {directInputs[index].bit, readPinLevel(directInputs[index].pin), (uint32_t)micros()};
+	edgeQueue.push(edge);
+	edgeCounts[index]++;
+}
+
+void directInputsBegin(){
+	for (uint8_t i = 0; i < NUM_DIRECT_INPUTS; i++) {
+		if (directInputs[i].pin < 0) continue;
+		pinMode(directInputs[i].pin, INPUT_PULLUP);
+		attachInterruptArg(directInputs[i].pin, directInputISR, (void*)(uintptr_t)i, CHANGE);
+		directMask |= (1 << directInputs[i].bit);
+	}
+	directLevels = readDirectLevels();
+}
+
+InputWord applyDirectInputs(InputWord raw){
+	// micros() and millis() wrap at different points, so carry the edge over by its age
+	unsigned long nowMs = millis();
+	uint32_t nowUs = micros();
+	InputEdge edge;
+	while (edgeQueue.pop(edge)) {
+		uint8_t mask = 1 << edge.bit;
+		directLevels = edge.level ? (directLevels | mask) : (directLevels & ~mask);
+		noteInputEdge(edge.bit, edge.level, nowMs - (nowUs - edge.timestamp) / 1000);
+	}
+	// Lost edges would leave a level wrong until the next one; read the pins instead
+	uint32_t dropped = edgeQueue.droppedCount();
+	if (dropped != lastDropped) {
+		lastDropped = dropped;
+		directLevels = readDirectLevels();
+	}
+	return (raw & ~(InputWord)directMask) | (directLevels & directMask);
+}
+
+// "direct" shows how many edges each pin produced; many more than twice the presses means bounce
+void directCommand(const char* args){
+	for (uint8_t i = 0; i < NUM_DIRECT_INPUTS; i++) {
+		if (directInputs[i].pin < 0) continue;
+		Serial.printf("GPIO %2d bit %u: %s, %u edges\n", directInputs[i].pin, directInputs[i].bit,
+			(directLevels & (1 << directInputs[i].bit)) ? "released" : "pressed", edgeCounts[i]);
+	}
+	Serial.printf("%u edges dropped\n", edgeQueue.droppedCount());
+}
+
+#endif
+
+#else
+
+void directCommand(const char* args){
+	Serial.println("Direct inputs disabled; build with DIRECT_INPUTS");
+}
+
+#endif
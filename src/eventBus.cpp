@@ -0,0 +1,46 @@
+#include "eventBus.hpp"
+
+static EventSubscriber subscribers[MAX_EVENT_SUBSCRIBERS];
+static const char* subscriberNames[MAX_EVENT_SUBSCRIBERS];
+static uint8_t subscriberMasks[MAX_EVENT_SUBSCRIBERS];
+static std::atomic<uint8_t> subscriberCount(0);
+static std::atomic<uint32_t> publishedCount[NUM_EVENT_TYPES];
+
+static portMUX_TYPE subscribeMux = portMUX_INITIALIZER_UNLOCKED;
+
+// The slot is filled before the count is published, so publishers never see a half-set subscriber
+EventSubscriber* subscribeEvents(const char* name, uint8_t typeMask){
+	portENTER_CRITICAL(&subscribeMux);
+	uint8_t index = subscriberCount.load(std::memory_order_relaxed);
+	if (index == MAX_EVENT_SUBSCRIBERS) {
+		portEXIT_CRITICAL(&subscribeMux);
+		Serial.println("Too many event subscribers!");
+		return nullptr;
+	}
+	subscriberNames[index] = name;
+	subscriberMasks[index] = typeMask;
+	subscriberCount.store(index + 1, std::memory_order_release);
+	portEXIT_CRITICAL(&subscribeMux);
+	return &subscribers[index];
+}
+
+void publishEvent(uint8_t type, uint8_t code, uint8_t value){
+	Event event = {type, code, value, (uint32_t)micros()};
+	uint8_t count = subscriberCount.load(std::memory_order_acquire);
+	for (uint8_t i = 0; i < count; i++) {
+		if (subscriberMasks[i] & EVENT_MASK(type)) subscribers[i].push(event);
+	}
+	publishedCount[type].fetch_add(1, std::memory_order_relaxed);
+}
+
+void busCommand(const char* args){
+	static const char* const typeNames[NUM_EVENT_TYPES] = {"button", "nudge", "mode", "connection"};
+	for (uint8_t type = 0; type < NUM_EVENT_TYPES; type++) {
+		Serial.printf("%-10s %u published\n", typeNames[type], publishedCount[type].load(std::memory_order_relaxed));
+	}
+	uint8_t count = subscriberCount.load(std::memory_order_acquire);
+	for (uint8_t i = 0; i < count; i++) {
+		Serial.printf("Subscriber %-8s mask 0x%02X, %u dropped\n", subscriberNames[i], subscriberMasks[i],
+			subscribers[i].droppedCount());
+	}
+}
@@ -0,0 +1,142 @@
+#include "gameProfiles.hpp"
+#include "bleConnectionManager.hpp"
+#include "eventBus.hpp"
+#include "safetySupervisor.hpp"
+#include "taskManager.hpp"
+
+const ButtonMapping questButtonMap[] = {
+		{BTN_BIT_RMAGNASAVE, KEY_RMAGNASAVE_QPVR},
+		{BTN_BIT_RFLIPPER,   KEY_RFLIPPER_QPVR},
+		{BTN_BIT_PLUNGER,    KEY_PLUNGER_QPVR},
+		{BTN_BIT_SPECIAL,    KEY_SPECIAL_QPVR},
+		{BTN_BIT_LMAGNASAVE, KEY_LMAGNASAVE_QPVR},
+		{BTN_BIT_LFLIPPER,   KEY_LFLIPPER_QPVR},
+		{BTN_BIT_START,      KEY_NUDGE_UP_QPVR}
+};
+
+const ButtonMapping pcButtonMap[] = {
+		{BTN_BIT_RMAGNASAVE, KEY_RMAGNASAVE_PCVP},
+		{BTN_BIT_RFLIPPER,   KEY_RFLIPPER_PCVP},
+		{BTN_BIT_PLUNGER,    KEY_PLUNGER_PCVP},
+		{BTN_BIT_SPECIAL,    KEY_SPECIAL_PCVP},
+		{BTN_BIT_START,      KEY_START_PCVP},
+		{BTN_BIT_LMAGNASAVE, KEY_LMAGNASAVE_PCVP},
+		{BTN_BIT_LFLIPPER,   KEY_LFLIPPER_PCVP}
+};
+
+// Pinball FX on PC has no coin slot
+const ButtonMapping pinballFxButtonMap[] = {
+		{BTN_BIT_RMAGNASAVE, KEY_RMAGNASAVE_PC},
+		{BTN_BIT_RFLIPPER,   KEY_RFLIPPER_PC},
+		{BTN_BIT_PLUNGER,    KEY_PLUNGER_PC},
+		{BTN_BIT_START,      KEY_START_PC},
+		{BTN_BIT_LMAGNASAVE, KEY_LMAGNASAVE_PC},
+		{BTN_BIT_LFLIPPER,   KEY_LFLIPPER_PC}
+};
+
+// Zaccaria, Future Pinball and MAME all take the full cabinet layout
+const ButtonMapping cabinetButtonMap[] = {
+		{BTN_BIT_RMAGNASAVE, KEY_RMAGNASAVE_PC},
+		{BTN_BIT_RFLIPPER,   KEY_RFLIPPER_PC},
+		{BTN_BIT_PLUNGER,    KEY_PLUNGER_PC},
+		{BTN_BIT_SPECIAL,    KEY_COIN_PC},
+		{BTN_BIT_START,      KEY_START_PC},
+		{BTN_BIT_LMAGNASAVE, KEY_LMAGNASAVE_PC},
+		{BTN_BIT_LFLIPPER,   KEY_LFLIPPER_PC}
+};
+
+#define MAP_SIZE(map) (sizeof(map) / sizeof(ButtonMapping))
+
+#ifdef SWITCH_MATRIX
+const ButtonMapping coinDoorButtonMap[] = {
+		{BTN_BIT_COIN1,          KEY_COIN1_PC},
+		{BTN_BIT_COIN2,          KEY_COIN2_PC},
+		{BTN_BIT_COIN_DOOR,      KEY_COIN_DOOR_PC},
+		{BTN_BIT_SERVICE_CANCEL, KEY_SERVICE_CANCEL_PC},
+		{BTN_BIT_SERVICE_DOWN,   KEY_SERVICE_DOWN_PC},
+		{BTN_BIT_SERVICE_UP,     KEY_SERVICE_UP_PC},
+		{BTN_BIT_SERVICE_ENTER,  KEY_SERVICE_ENTER_PC},
+		{BTN_BIT_EXIT,           KEY_EXIT_PC}
+};
+
+const uint8_t NUM_COIN_DOOR_BUTTONS = MAP_SIZE(coinDoorButtonMap);
+#endif
+
+const GameProfile gameProfiles[NUM_GAME_MODES] = {
+	// Quest nudges sideways only, on the MagnaSave keys. The PC profiles keep Visual Pinball's
+	// original rule: sideways whenever X is over the threshold, forward only otherwise.
+	// Visual Pinball, Pinball FX and MAME read a joystick next to the keyboard; the others don't
+	{"Quest Pinball FX VR", questButtonMap, MAP_SIZE(questButtonMap),
+		{KEY_LMAGNASAVE_QPVR, KEY_RMAGNASAVE_QPVR, 0, false}, 0x0000FF, HID_TYPE_KEYBOARD},  // Blue
+	{"PC Visual Pinball", pcButtonMap, MAP_SIZE(pcButtonMap),
+		{KEY_NUDGE_LEFT_PCVP, KEY_NUDGE_RIGHT_PCVP, KEY_NUDGE_UP_PCVP, true}, 0xFF00FF, HID_TYPE_GAMEPAD},  // Purple/Magenta
+	{"PC Pinball FX", pinballFxButtonMap, MAP_SIZE(pinballFxButtonMap),
+		{KEY_NUDGE_LEFT_PC, KEY_NUDGE_RIGHT_PC, KEY_NUDGE_UP_PC, true}, 0x00FFFF, HID_TYPE_GAMEPAD},  // Cyan
+	{"Zaccaria Pinball", cabinetButtonMap, MAP_SIZE(cabinetButtonMap),
+		{KEY_NUDGE_LEFT_PC, KEY_NUDGE_RIGHT_PC, KEY_NUDGE_UP_PC, true}, 0xFF8000, HID_TYPE_KEYBOARD},  // Orange
+	{"Future Pinball", cabinetButtonMap, MAP_SIZE(cabinetButtonMap),
+		{KEY_NUDGE_LEFT_PC, KEY_NUDGE_RIGHT_PC, KEY_NUDGE_UP_PC, true}, 0xFFFF00, HID_TYPE_KEYBOARD},  // Yellow
+	{"MAME", cabinetButtonMap, MAP_SIZE(cabinetButtonMap),
+		{KEY_NUDGE_LEFT_PC, KEY_NUDGE_RIGHT_PC, KEY_NUDGE_UP_PC, true}, 0xFF0000, HID_TYPE_GAMEPAD}   // Red
+};
+
+const GameProfile* activeProfile = &gameProfiles[QUEST_PINBALL_FX_VR];
+
+static void printProfile(){
+	Serial.printf("Game profile: %s (%s)\n", activeProfile->name,
+		(activeProfile->hidType == HID_TYPE_GAMEPAD) ? "keyboard and gamepad" : "keyboard");
+}
+
+void selectGameProfile(int mode){
+	activeProfile = &gameProfiles[mode];
+	loadButtonMap(mode);
+	bleProfileChanged();
+	printProfile();
+}
+
+static int pendingMode;
+static unsigned long swapMicros;
+
+// Between two scans: nothing held under the old mapping survives the switch
+static void swapModeJob(const char* args){
+	unsigned long start = micros();
+	forceReleaseAll(RELEASE_MODE_CHANGE);
+	resetButtonStates();
+
+	currentGameMode = pendingMode;
+	activeProfile = &gameProfiles[pendingMode];
+	installButtonMap();
+	publishEvent(EVENT_MODE_CHANGE, pendingMode, 0);
+	swapMicros = micros() - start;
+}
+
+// The new map and the profile's BLE host come out of flash here on the system task; only the swap
+// itself runs on the input task. The BLE link stays up and the new mode is persisted by the
+// deferred settings flush. The accelerometer and LED strip follow EVENT_MODE_CHANGE.
+// A saved map with pad actions is refused for a keyboard profile (see stageButtonMap), so the
+// trigger axes that follow pad actions stop with it
+void switchControllerMode(int mode){
+	stageButtonMap(mode);
+	pendingMode = mode;
+	runOnInputTask(swapModeJob, "");
+	bleProfileChanged();
+	printProfile();
+	Serial.printf("Switched to mode %d in %lu us\n", mode, swapMicros);
+}
+
+// "mode" lists the profiles, "mode <n>" switches to one
+void modeCommand(const char* args){
+	if (*args == '\0') {
+		for (uint8_t i = 0; i < NUM_GAME_MODES; i++) {
+			Serial.printf("%c %u: %s\n", (i == currentGameMode) ? '*' : ' ', i, gameProfiles[i].name);
+		}
+		return;
+	}
+	int mode = atoi(args);
+	if (mode < 0 || mode >= NUM_GAME_MODES) {
+		Serial.printf("mode must be 0..%d\n", NUM_GAME_MODES - 1);
+		return;
+	}
+	saveControllerMode(mode);
+	switchControllerMode(mode);
+}
@@ -0,0 +1,48 @@
+#include "hidOutput.hpp"
+
+#ifdef OUTPUT_BACKEND_BLE
+
+#include "bleHidKeyboard.hpp"
+#include "bleConnectionManager.hpp"
+
+BleHidKeyboard keyboard("pinballWizard", "cc", 68);
+
+void outputBegin(){
+	bleConnectionBegin();
+	keyboard.begin();
+}
+
+bool outputConnected(){
+	return keyboard.isConnected();
+}
+
+void outputPress(uint8_t key){
+	keyboard.press(key);
+}
+
+void outputRelease(uint8_t key){
+	keyboard.release(key);
+}
+
+void outputReleaseAll(){
+	keyboard.releaseAll();
+}
+
+void outputGamepadPress(uint8_t button){
+	keyboard.padPress(button);
+}
+
+void outputGamepadRelease(uint8_t button){
+	keyboard.padRelease(button);
+}
+
+// The report carries every axis, so the changed bits only matter to backends that report per axis
+void outputGamepadAxes(const int8_t values[NUM_PAD_AXES], uint8_t changed){
+	keyboard.setAxes(values);
+}
+
+uint32_t outputReportIntervalUs(){
+	return bleReportIntervalUs();
+}
+
+#endif
@@ -0,0 +1,79 @@
+#include "hidOutput.hpp"
+
+#ifdef OUTPUT_BACKEND_FAKE
+
+static FakeOutputEvent eventLog[FAKE_OUTPUT_LOG_LENGTH];
+static uint8_t eventCount = 0;
+static uint8_t axisReportCount = 0;
+static bool fakeConnected = true;
+static uint32_t fakeReportIntervalUs = 0;
+
+static void record(uint8_t type, uint8_t code, int8_t value = 0){
+	if (eventCount == FAKE_OUTPUT_LOG_LENGTH) return;
+	eventLog[eventCount].type = type;
+	eventLog[eventCount].code = code;
+	eventLog[eventCount].value = value;
+	eventCount++;
+}
+
+void outputBegin(){
+}
+
+bool outputConnected(){
+	return fakeConnected;
+}
+
+void outputPress(uint8_t key){
+	record(FAKE_KEY_PRESS, key);
+}
+
+void outputRelease(uint8_t key){
+	record(FAKE_KEY_RELEASE, key);
+}
+
+void outputReleaseAll(){
+	record(FAKE_RELEASE_ALL, 0);
+}
+
+void outputGamepadPress(uint8_t button){
+	record(FAKE_PAD_PRESS, button);
+}
+
+void outputGamepadRelease(uint8_t button){
+	record(FAKE_PAD_RELEASE, button);
+}
+
+void outputGamepadAxes(const int8_t values[NUM_PAD_AXES], uint8_t changed){
+	axisReportCount++;
+	for (uint8_t axis = 0; axis < NUM_PAD_AXES; axis++) {
+		if (changed & (1 << axis)) record(FAKE_PAD_AXIS, axis, values[axis]);
+	}
+}
+
+uint32_t outputReportIntervalUs(){
+	return fakeReportIntervalUs;
+}
+
+const FakeOutputEvent* fakeOutputLog(uint8_t* count){
+	*count = eventCount;
+	return eventLog;
+}
+
+void fakeOutputClear(){
+	eventCount = 0;
+	axisReportCount = 0;
+}
+
+uint8_t fakeOutputAxisReports(){
+	return axisReportCount;
+}
+
+void fakeOutputSetConnected(bool connected){
+	fakeConnected = connected;
+}
+
+void fakeOutputSetReportInterval(uint32_t intervalUs){
+	fakeReportIntervalUs = intervalUs;
+}
+
+#endif
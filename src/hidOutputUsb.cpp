@@ -0,0 +1,64 @@
+#include "hidOutput.hpp"
+
+#ifdef OUTPUT_BACKEND_USB
+
+#include <USB.h>
+#include <USBHIDGamepad.h>
+
+// The core's HID interface asks for a 1 ms polling interval
+#define USB_POLL_INTERVAL_US   1000
+static USBHIDKeyboard usbKeyboard;
+static USBHIDGamepad usbGamepad;
+static uint32_t padButtons = 0;     // send() takes the whole report, buttons included
+
+void outputBegin(){
+	usbKeyboard.begin();
+	usbGamepad.begin();
+	USB.productName("pinballWizard");
+	USB.manufacturerName("cc");
+	USB.begin();
+}
+
+// True once the host has enumerated and configured the device
+bool outputConnected(){
+	return (bool)USB;
+}
+
+void outputPress(uint8_t key){
+	usbKeyboard.press(key);
+}
+
+void outputRelease(uint8_t key){
+	usbKeyboard.release(key);
+}
+
+void outputReleaseAll(){
+	usbKeyboard.releaseAll();
+	usbGamepad.send(0, 0, 0, 0, 0, 0, 0, 0);
+	padButtons = 0;
+}
+
+void outputGamepadPress(uint8_t button){
+	if (!button) return;
+	padButtons |= (1UL << (button - 1));
+	usbGamepad.pressButton(button - 1);
+}
+
+void outputGamepadRelease(uint8_t button){
+	if (!button) return;
+	padButtons &= ~(1UL << (button - 1));
+	usbGamepad.releaseButton(button - 1);
+}
+
+// One report for all of them: Z on the right stick's Z (Rz unused), the triggers on Rx and Ry,
+// which is where the core's rightStick(), leftTrigger() and rightTrigger() put them
+void outputGamepadAxes(const int8_t values[NUM_PAD_AXES], uint8_t changed){
+	usbGamepad.send(0, 0, values[PAD_AXIS_Z], 0, values[PAD_AXIS_LEFT_TRIGGER], values[PAD_AXIS_RIGHT_TRIGGER],
+		0, padButtons);
+}
+
+uint32_t outputReportIntervalUs(){
+	return USB_POLL_INTERVAL_US;
+}
+
+#endif
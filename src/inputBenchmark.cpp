@@ -0,0 +1,178 @@
+#include "inputBenchmark.hpp"
+
+#ifdef INPUT_BENCHMARK
+
+#include "arcadeButtonProcessor.hpp"
+#include "accelerometerProcessor.hpp"
+#include "keyArbiter.hpp"
+#include "taskManager.hpp"
+
+extern MPU6050 mpu;
+extern bool accelerometerEnabled;
+extern InputWord stableState;
+extern InputWord lastRawState;
+extern unsigned long lastChangeTime[NUM_INPUT_BITS];
+
+struct BenchResult {
+	uint32_t minCycles;
+	uint32_t maxCycles;
+	uint64_t totalCycles;
+};
+
+// Holds a whole scan, 64 bits with SWITCH_MATRIX
+static volatile InputWord benchSink;
+static InputWord benchRaw;
+
+static void benchEmpty(){
+}
+
+static void benchReadShiftRegister(){
+	benchSink = readShiftRegister();
+}
+
+#ifdef SWITCH_MATRIX
+static void benchScanSwitchMatrix(){
+	benchSink = scanSwitchMatrix();
+}
+#endif
+
+// Raw matches the debounced state: the cost every idle scan pays
+static void benchDebounceSteady(){
+	updateButtonStates(stableState, millis());
+}
+
+// Every mapped bit changes each call, resetting the debounce timers without reaching an edge
+static void benchDebounceBouncing(){
+	benchRaw = ~benchRaw;
+	updateButtonStates(benchRaw, millis());
+}
+
+static void benchAccelRead(){
+	int16_t x, y, z;
+	mpu.getAcceleration(&x, &y, &z);
+}
+
+static void benchCheckNudge(){
+	checkNudge();
+}
+
+// Alternate press and release reports for a key no profile uses, owned by the input bit that has
+// nothing assigned, so keys held by real buttons are left alone. An even iteration count ends
+// with the key up
+#define BENCH_KEY       KEY_F24
+static bool benchKeyDown = false;
+
+static void benchHidReport(){
+	benchKeyDown = !benchKeyDown;
+	if (benchKeyDown) pressKey(BTN_BIT_NOTUSED, BENCH_KEY);
+	else releaseKey(BTN_BIT_NOTUSED, BENCH_KEY);
+}
+
+static BenchResult measure(void (*fn)(), uint32_t iterations){
+	BenchResult result = {UINT32_MAX, 0, 0};
+	for (uint32_t i = 0; i < iterations; i++) {
+		uint32_t start = ESP.getCycleCount();
+		fn();
+		uint32_t cycles = ESP.getCycleCount() - start;
+		if (cycles < result.minCycles) result.minCycles = cycles;
+		if (cycles > result.maxCycles) result.maxCycles = cycles;
+		result.totalCycles += cycles;
+	}
+	return result;
+}
+
+// Measured on the input task, printed afterwards from the system task
+struct BenchRow {
+	const char* name;
+	const char* skipped;     // why it didn't run, or nullptr
+	uint32_t iterations;
+	BenchResult result;
+};
+
+#define MAX_BENCH_ROWS   8
+
+static BenchRow benchRows[MAX_BENCH_ROWS];
+static uint8_t benchRowCount = 0;
+
+static void addRow(const char* name, void (*fn)(), uint32_t iterations){
+	if (benchRowCount == MAX_BENCH_ROWS) return;
+	BenchRow& row = benchRows[benchRowCount++];
+	row.name = name;
+	row.skipped = nullptr;
+	row.iterations = iterations;
+	row.result = measure(fn, iterations);
+}
+
+static void addSkipped(const char* name, const char* reason){
+	if (benchRowCount == MAX_BENCH_ROWS) return;
+	BenchRow& row = benchRows[benchRowCount++];
+	row.name = name;
+	row.skipped = reason;
+}
+
+static void measureJob(const char* args){
+	// The debounce benchmarks feed synthetic scans, so put the real state back afterwards
+	InputWord savedRaw = lastRawState;
+	unsigned long savedChangeTime[NUM_INPUT_BITS];
+	memcpy(savedChangeTime, lastChangeTime, sizeof(savedChangeTime));
+	benchRaw = stableState;
+
+	benchRowCount = 0;
+	addRow("empty call", benchEmpty, BENCH_ITERATIONS);
+	addRow("readShiftRegister", benchReadShiftRegister, BENCH_ITERATIONS);
+#ifdef SWITCH_MATRIX
+	addRow("scanSwitchMatrix", benchScanSwitchMatrix, BENCH_ITERATIONS);
+#endif
+	addRow("debounce (steady)", benchDebounceSteady, BENCH_ITERATIONS);
+	addRow("debounce (bouncing)", benchDebounceBouncing, BENCH_ITERATIONS);
+
+	lastRawState = savedRaw;
+	memcpy(lastChangeTime, savedChangeTime, sizeof(savedChangeTime));
+
+	if (accelerometerEnabled) {
+		addRow("mpu.getAcceleration", benchAccelRead, BENCH_SLOW_ITERATIONS);
+		addRow("checkNudge", benchCheckNudge, BENCH_SLOW_ITERATIONS);
+	} else {
+		addSkipped("mpu.getAcceleration", "no accelerometer");
+		addSkipped("checkNudge", "no accelerometer");
+	}
+
+	if (outputConnected()) {
+		addRow("HID press/release", benchHidReport, BENCH_SLOW_ITERATIONS);
+		if (benchKeyDown) benchHidReport();
+	} else {
+		addSkipped("HID report send", "not connected");
+	}
+}
+
+void runInputBenchmarks(){
+	runOnInputTask(measureJob, "");
+
+	Serial.printf("=== Input benchmarks (CPU %u MHz, cycles per call) ===\n", ESP.getCpuFreqMHz());
+	Serial.printf("%-24s %6s %10s %10s %10s %9s\n", "benchmark", "iters", "min", "avg", "max", "avg us");
+	for (uint8_t i = 0; i < benchRowCount; i++) {
+		const BenchRow& row = benchRows[i];
+		if (row.skipped) {
+			Serial.printf("%-24s skipped (%s)\n", row.name, row.skipped);
+			continue;
+		}
+		uint32_t avg = row.result.totalCycles / row.iterations;
+		Serial.printf("%-24s %6u %10u %10u %10u %9.2f\n", row.name, row.iterations,
+			row.result.minCycles, avg, row.result.maxCycles, (float)avg / ESP.getCpuFreqMHz());
+	}
+}
+
+void benchCommand(const char* args){
+	runInputBenchmarks();
+}
+
+#else
+
+void runInputBenchmarks(){
+}
+
+void benchCommand(const char* args){
+	Serial.println("Benchmarks disabled; build the benchmark environment");
+}
+
+#endif
@@ -0,0 +1,112 @@
+#include "inputExpander.hpp"
+
+#ifdef INPUT_EXPANDER
+
+#include <Wire.h>
+#include "arcadeButtonProcessor.hpp"
+#include "preferencesManager.hpp"
+
+static uint8_t lastState = 0xFF;
+static unsigned long lastRead = 0;
+static uint32_t interruptReads = 0;
+static uint32_t resyncReads = 0;
+static uint32_t capturedPulses = 0;   // edges that were over before the port was read
+static uint8_t heldBits = 0;          // pulses being reported at their captured level
+static uint8_t heldLevels = 0;
+static unsigned long heldSince = 0;
+static bool expanderFound = false;
+
+static void writeRegister(uint8_t reg, uint8_t value){
+	Wire1.beginTransmission(EXPANDER_ADDRESS);
+	Wire1.write(reg);
+	Wire1.write(value);
+	Wire1.endTransmission();
+}
+
+bool expanderBegin(){
+	pinMode(EXPANDER_INT, INPUT_PULLUP);
+	Wire1.begin(EXPANDER_SDA, EXPANDER_SCL, EXPANDER_I2C_HZ);
+	Wire1.beginTransmission(EXPANDER_ADDRESS);
+	expanderFound = (Wire1.endTransmission() == 0);
+	if (!expanderFound) {
+		Serial.println("MCP23017 not found!");
+		return false;
+	}
+	writeRegister(MCP_IOCON, 0x00);       // sequential addressing, INTA push-pull active low
+	writeRegister(MCP_IODIRA, 0xFF);
+	writeRegister(MCP_GPPUA, 0xFF);
+	writeRegister(MCP_INTCONA, 0x00);     // interrupt on any change from the previous level
+	writeRegister(MCP_GPINTENA, 0xFF);
+	lastRead = millis() - EXPANDER_RESYNC_MS;
+	return true;
+}
+
+// INTCAPA holds the port as it was when the interrupt fired and GPIOA as it is now; reading them
+// in one transaction clears the interrupt
+static bool readPort(uint8_t* captured, uint8_t* current){
+	Wire1.beginTransmission(EXPANDER_ADDRESS);
+	Wire1.write(MCP_INTCAPA);
+	if (Wire1.endTransmission(false) != 0) return false;
+	if (Wire1.requestFrom((uint8_t)EXPANDER_ADDRESS, (uint8_t)3) != 3) return false;
+	*captured = Wire1.read();
+	Wire1.read();                         // INTCAPB
+	*current = Wire1.read();
+	return true;
+}
+
+// A captured pulse stays at its captured level until updateButtonStates() has taken it as an edge
+// (one debounce time), then the port's level comes back and makes the second edge
+static uint8_t withHeldPulses(uint8_t state, unsigned long now){
+	if (heldBits && now - heldSince > (unsigned long)getSetting(SETTING_DEBOUNCE_MS)) heldBits = 0;
+	return (state & ~heldBits) | (heldLevels & heldBits);
+}
+
+uint8_t readExpander(){
+	if (!expanderFound) return 0xFF;
+	unsigned long now = millis();
+	bool interrupted = (digitalRead(EXPANDER_INT) == LOW);
+	if (!interrupted && now - lastRead < EXPANDER_RESYNC_MS) return withHeldPulses(lastState, now);
+
+	uint8_t captured, current;
+	if (!readPort(&captured, &current)) return withHeldPulses(lastState, now);
+	lastRead = now;
+	if (interrupted) {
+		interruptReads++;
+		// A pin that moved and came back before this read only shows up in INTCAP
+		uint8_t pulses = (captured ^ lastState) & ~(current ^ lastState) & ~heldBits;
+		capturedPulses += __builtin_popcount(pulses);
+		if (getSetting(SETTING_EXPANDER_PULSES) == EXPANDER_PULSE_PRESS) {
+			heldLevels = (heldLevels & ~pulses) | (captured & pulses);
+			heldBits |= pulses;
+			if (pulses) heldSince = now;
+		} else {
+			while (pulses) {
+				uint8_t bit = __builtin_ctz(pulses);
+				pulses &= pulses - 1;
+				noteInputEdge(bit, (current >> bit) & 1, now);
+			}
+		}
+	} else {
+		resyncReads++;
+	}
+	lastState = current;
+	return withHeldPulses(current, now);
+}
+
+void expanderCommand(const char* args){
+	if (!expanderFound) {
+		Serial.println("MCP23017 not found");
+		return;
+	}
+	Serial.printf("Port 0x%02X, %u interrupt reads, %u resyncs, %u captured pulses (%s)\n",
+		lastState, interruptReads, resyncReads, capturedPulses,
+		(getSetting(SETTING_EXPANDER_PULSES) == EXPANDER_PULSE_PRESS) ? "reported as presses" : "treated as bounce");
+}
+
+#else
+
+void expanderCommand(const char* args){
+	Serial.println("Input expander disabled; build with INPUT_EXPANDER");
+}
+
+#endif
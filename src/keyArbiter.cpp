@@ -0,0 +1,153 @@
+#include "keyArbiter.hpp"
+#include "hidOutput.hpp"
+#include "traceRecorder.hpp"
+#include "axisReporter.hpp"
+#include "taskManager.hpp"
+
+// Gamepad buttons share the owners' hold lists with keys, above the key code range
+#define PAD_CODE(button)    (0x100 | (button))
+
+struct OwnerHolds {
+	uint8_t count;
+	uint16_t codes[MAX_OWNER_HOLDS];
+	unsigned long since;
+};
+
+// How many owners hold each key / gamepad button, and what each owner holds
+static uint8_t keyRefs[256];
+static uint8_t padRefs[MAX_PAD_BUTTONS + 1];
+static OwnerHolds ownerHolds[NUM_KEY_OWNERS];
+static uint8_t holdingOwners = 0;
+
+// Adds code to the owner's list; false if it was already there (or the list is full)
+static bool take(uint8_t owner, uint16_t code){
+	OwnerHolds& holds = ownerHolds[owner];
+	for (uint8_t i = 0; i < holds.count; i++) {
+		if (holds.codes[i] == code) return false;
+	}
+	if (holds.count == MAX_OWNER_HOLDS) return false;
+	if (holds.count == 0) {
+		holds.since = millis();
+		holdingOwners++;
+	}
+	holds.codes[holds.count++] = code;
+	return true;
+}
+
+// Removes code from the owner's list; false if the owner didn't hold it
+static bool let(uint8_t owner, uint16_t code){
+	OwnerHolds& holds = ownerHolds[owner];
+	for (uint8_t i = 0; i < holds.count; i++) {
+		if (holds.codes[i] != code) continue;
+		holds.codes[i] = holds.codes[--holds.count];
+		if (holds.count == 0) holdingOwners--;
+		return true;
+	}
+	return false;
+}
+
+void pressKey(uint8_t owner, uint8_t key){
+	if (!take(owner, key)) return;
+	if (keyRefs[key]++ == 0) {
+		outputPress(key);
+		traceHidEvent(key, true);
+	}
+}
+
+void releaseKey(uint8_t owner, uint8_t key){
+	if (!let(owner, key)) return;
+	if (--keyRefs[key] == 0) {
+		outputRelease(key);
+		traceHidEvent(key, false);
+	}
+}
+
+void pressPadButton(uint8_t owner, uint8_t button){
+	if (button == 0 || button > MAX_PAD_BUTTONS) return;
+	if (!take(owner, PAD_CODE(button))) return;
+	if (padRefs[button]++ == 0) outputGamepadPress(button);
+}
+
+void releasePadButton(uint8_t owner, uint8_t button){
+	if (button == 0 || button > MAX_PAD_BUTTONS) return;
+	if (!let(owner, PAD_CODE(button))) return;
+	if (--padRefs[button] == 0) outputGamepadRelease(button);
+}
+
+void releaseAllKeys(){
+	memset(keyRefs, 0, sizeof(keyRefs));
+	for (uint8_t button = 1; button <= MAX_PAD_BUTTONS; button++) {
+		if (padRefs[button]) outputGamepadRelease(button);
+		padRefs[button] = 0;
+	}
+	for (uint8_t owner = 0; owner < NUM_KEY_OWNERS; owner++) {
+		ownerHolds[owner].count = 0;
+	}
+	holdingOwners = 0;
+	outputReleaseAll();
+	resetAxisReports();
+}
+
+void releaseOwner(uint8_t owner){
+	OwnerHolds& holds = ownerHolds[owner];
+	while (holds.count) {
+		uint16_t code = holds.codes[holds.count - 1];
+		if (code & PAD_CODE(0)) releasePadButton(owner, code & 0xFF);
+		else releaseKey(owner, code);
+	}
+}
+
+uint8_t holdingOwnerCount(){
+	return holdingOwners;
+}
+
+bool ownerHolding(uint8_t owner){
+	return ownerHolds[owner].count != 0;
+}
+
+unsigned long ownerHeldSince(uint8_t owner){
+	return ownerHolds[owner].since;
+}
+
+// Copied between two scans so "keys" prints one consistent moment from the system task
+static uint8_t keyRefsSnapshot[256];
+static uint8_t padRefsSnapshot[MAX_PAD_BUTTONS + 1];
+static OwnerHolds holdsSnapshot[NUM_KEY_OWNERS];
+
+static void snapshotJob(const char* args){
+	memcpy(keyRefsSnapshot, keyRefs, sizeof(keyRefs));
+	memcpy(padRefsSnapshot, padRefs, sizeof(padRefs));
+	memcpy(holdsSnapshot, ownerHolds, sizeof(ownerHolds));
+}
+
+static void printOwners(uint16_t code){
+	for (uint8_t owner = 0; owner < NUM_KEY_OWNERS; owner++) {
+		const OwnerHolds& holds = holdsSnapshot[owner];
+		for (uint8_t i = 0; i < holds.count; i++) {
+			if (holds.codes[i] != code) continue;
+			if (owner == KEY_OWNER_NUDGE) Serial.print(" nudge");
+			else if (owner == KEY_OWNER_PLUNGER) Serial.print(" plunger");
+			else Serial.printf(" bit%u", owner);
+		}
+	}
+	Serial.println();
+}
+
+// "keys" lists every held key and gamepad button with the sources holding it
+void keysCommand(const char* args){
+	runOnInputTask(snapshotJob, "");
+	bool any = false;
+	for (uint16_t key = 0; key < 256; key++) {
+		if (!keyRefsSnapshot[key]) continue;
+		Serial.printf("key 0x%02X:", key);
+		printOwners(key);
+		any = true;
+	}
+	for (uint8_t button = 1; button <= MAX_PAD_BUTTONS; button++) {
+		if (!padRefsSnapshot[button]) continue;
+		Serial.printf("pad %u:", button);
+		printOwners(PAD_CODE(button));
+		any = true;
+	}
+	if (!any) Serial.println("No keys held");
+}
@@ -1,10 +1,26 @@
-#include "ledStripProcessor.hpp"
-
-Adafruit_NeoPixel pixels(NUM_STRIP_LEDS, PIN_LED_STRIP, NEO_GRB + NEO_KHZ800);
-
-void setLEDStrip(int mode){
-	pixels.begin();
-	pixels.setBrightness(100);
-	pixels.fill(gameModeColors[mode]);
-	pixels.show();
+#include "ledStripProcessor.hpp"
+#include "preferencesManager.hpp"
+#include "gameProfiles.hpp"
+#include "eventBus.hpp"
+
+Adafruit_NeoPixel pixels(NUM_STRIP_LEDS, PIN_LED_STRIP, NEO_GRB + NEO_KHZ800);
+
+void setLEDStrip(int mode){
+	pixels.begin();
+	pixels.setBrightness(getSetting(SETTING_LED_BRIGHTNESS));
+	pixels.fill(gameProfiles[mode].ledColor);
+	pixels.show();
+}
+
+// Repaints the strip in the new mode's colour; the mode switch itself never waits on the strip
+void serviceLEDStrip(){
+	static EventSubscriber* modeEvents = subscribeEvents("ledStrip", EVENT_MASK(EVENT_MODE_CHANGE));
+	Event event;
+	bool changed = false;
+	int mode = 0;
+	while (modeEvents && modeEvents->pop(event)) {
+		mode = event.code;
+		changed = true;
+	}
+	if (changed) setLEDStrip(mode);
 }
\ No newline at end of file
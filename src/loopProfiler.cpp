@@ -0,0 +1,132 @@
+#include "loopProfiler.hpp"
+
+#ifdef LOOP_PROFILER
+
+struct ProfileStats {
+	uint32_t count;
+	uint64_t totalMicros;
+	uint32_t maxMicros;
+	uint32_t histogram[PROFILE_BUCKETS];
+};
+
+static const char* const stageNames[NUM_PROFILE_STAGES] = {
+	"console",
+	"boot button",
+	"nudge",
+	"led status"
+};
+
+static ProfileStats stageStats[NUM_PROFILE_STAGES];
+static ProfileStats loopStats;            // full iteration period, including time outside loop()
+static uint32_t stallCount = 0;
+static uint32_t stallsByStage[NUM_PROFILE_STAGES];
+
+static uint32_t loopStart = 0;
+static uint32_t lastMark = 0;
+static uint32_t iterationStage[NUM_PROFILE_STAGES];  // stage times of the running iteration
+static bool iterationStarted = false;
+static unsigned long statsSince = 0;
+
+static inline uint8_t bucketFor(uint32_t micros){
+	if (micros == 0) return 0;
+	uint8_t bucket = 32 - __builtin_clz(micros);
+	return bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1;
+}
+
+static inline void record(ProfileStats& stats, uint32_t micros){
+	stats.count++;
+	stats.totalMicros += micros;
+	if (micros > stats.maxMicros) stats.maxMicros = micros;
+	stats.histogram[bucketFor(micros)]++;
+}
+
+void profileLoopBegin(){
+	uint32_t now = micros();
+	if (iterationStarted) {
+		uint32_t period = now - loopStart;
+		record(loopStats, period);
+		if (period > PROFILE_STALL_US) {
+			// Blame the stage that took longest in the slow iteration
+			uint8_t worst = 0;
+			for (uint8_t i = 1; i < NUM_PROFILE_STAGES; i++) {
+				if (iterationStage[i] > iterationStage[worst]) worst = i;
+			}
+			stallCount++;
+			stallsByStage[worst]++;
+		}
+	}
+	memset(iterationStage, 0, sizeof(iterationStage));
+	iterationStarted = true;
+	loopStart = now;
+	lastMark = now;
+}
+
+void profileStageEnd(PROFILE_STAGE stage){
+	uint32_t now = micros();
+	uint32_t elapsed = now - lastMark;
+	record(stageStats[stage], elapsed);
+	iterationStage[stage] += elapsed;
+	lastMark = now;
+}
+
+static void printHistogram(const char* name, const ProfileStats& stats){
+	Serial.printf("%-12s", name);
+	for (uint8_t i = 0; i < PROFILE_BUCKETS; i++) {
+		Serial.printf(" %7u", stats.histogram[i]);
+	}
+	Serial.println();
+}
+
+static void printReport(){
+	unsigned long elapsed = millis() - statsSince;
+	Serial.printf("=== Loop profile over %lu ms ===\n", elapsed);
+	if (loopStats.count > 0 && elapsed > 0) {
+		Serial.printf("loop: %u iterations, %lu Hz, avg %u us, max %u us, %u stalls > %u us\n",
+			loopStats.count, (unsigned long)(loopStats.count * 1000ULL / elapsed),
+			(uint32_t)(loopStats.totalMicros / loopStats.count), loopStats.maxMicros,
+			stallCount, PROFILE_STALL_US);
+	}
+	Serial.printf("%-12s %8s %8s %8s %8s\n", "stage", "calls", "avg us", "max us", "stalls");
+	for (uint8_t i = 0; i < NUM_PROFILE_STAGES; i++) {
+		const ProfileStats& stats = stageStats[i];
+		uint32_t avg = stats.count ? stats.totalMicros / stats.count : 0;
+		Serial.printf("%-12s %8u %8u %8u %8u\n", stageNames[i], stats.count, avg, stats.maxMicros, stallsByStage[i]);
+	}
+
+	Serial.printf("%-12s", "us <");
+	for (uint8_t i = 0; i < PROFILE_BUCKETS; i++) {
+		if (i == PROFILE_BUCKETS - 1) Serial.printf(" %7s", "more");
+		else Serial.printf(" %7u", 1u << i);
+	}
+	Serial.println();
+	printHistogram("loop", loopStats);
+	for (uint8_t i = 0; i < NUM_PROFILE_STAGES; i++) {
+		printHistogram(stageNames[i], stageStats[i]);
+	}
+}
+
+static void resetStats(){
+	memset(stageStats, 0, sizeof(stageStats));
+	memset(&loopStats, 0, sizeof(loopStats));
+	memset(stallsByStage, 0, sizeof(stallsByStage));
+	stallCount = 0;
+	iterationStarted = false;
+	statsSince = millis();
+}
+
+void profileCommand(const char* args){
+	if (strcmp(args, "reset") == 0) {
+		resetStats();
+		Serial.println("Profile reset");
+	} else {
+		printReport();
+	}
+}
+
+#else
+
+void profileCommand(const char* args){
+	Serial.println("Loop profiler disabled; build with LOOP_PROFILER");
+}
+
+#endif
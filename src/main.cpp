@@ -1,101 +1,144 @@
-#include "arcadeButtonProcessor.hpp"
-#include "ledStripProcessor.hpp"
-#include "accelerometerProcessor.hpp"
-#include "solenoidProcessor.hpp"
-#include "preferencesManager.hpp"
-
-// Onboard NeoPixel; single LED
-#define PIN_NEOPIXEL      5
-#define NEOPIXEL_POWER    8
-
-#define TIME_IN_MS_HOLD_FOR_MODE_CHANGE 2000
-
-bool connected = false;
-bool ledOn = false;
-bool resetHeld = false;
-bool accelerometerEnabled = false;
-bool nudgeActive = false;
-int currentGameMode = 0;
-unsigned long lastBlink = 0;
-unsigned long lastResetPress = 0;
-BleKeyboard keyboard("pinballWizard", "cc", 68);
-MPU6050 mpu;
-
-void setLED(uint8_t r, uint8_t g, uint8_t b) {
-	neopixelWrite(PIN_NEOPIXEL, r, g, b);
-}
-
-void setup() {
-	Serial.begin(115200);
-	delay(1000);
-	Serial.println("=== Pinball Controller Starting ===");
-
-	// Start accelerometer pins and init (chip is MPU6050)
-	Wire.begin(ACCELEROMETER_SDA, ACCELEROMETER_SCL);
-	mpu.initialize();
-	
-	pinMode(BOOT_BUTTON, INPUT_PULLUP);
-	pinMode(NEOPIXEL_POWER, OUTPUT);
-	pinMode(SR_LOAD, OUTPUT);
-	pinMode(SR_CLK, OUTPUT);
-	pinMode(SR_DATA, INPUT);
-	pinMode(LEFT_SOLENOID, OUTPUT);
-  	pinMode(RIGHT_SOLENOID, OUTPUT);
-	
-	digitalWrite(NEOPIXEL_POWER, HIGH);
-	digitalWrite(SR_LOAD, HIGH);
-	digitalWrite(SR_CLK, LOW);
-	digitalWrite(LEFT_SOLENOID, LOW); 
-	digitalWrite(RIGHT_SOLENOID, LOW); 
-
-	tryToStartAccelerometer();
-	
-	currentGameMode = getControllerMode();
-	keyboard.begin();
-
-	setLEDStrip(currentGameMode);
-}
-
-void loop() {
-	if (digitalRead(BOOT_BUTTON) == LOW) {
-		if(lastResetPress == 0){
-			resetHeld = true;
-			lastResetPress = millis();
-		}
-		if(resetHeld){
-			if(millis() - lastResetPress >= TIME_IN_MS_HOLD_FOR_MODE_CHANGE) {
-				gotoNextMode(currentGameMode);
-				delay(1000); // blocking but that's okay; I want to be sure the save happens
-				Serial.println("Restarting the ESP 32...");
-				ESP.restart();
-			} else {
-				return; // we want to exit loop early so that lastResetPress isn't set to 0/ 
-			}
-		}
-	}
-	lastResetPress = 0;
-	resetHeld = false;
-
-	// if we have a bluetooth connection, let's do the important stuff
-	if(keyboard.isConnected()){
-		// process button presses first
-		processKeyboardButtons(&keyboard);
-		// process movement next (but only if accelerometer is enabled)
-		if(accelerometerEnabled) {
-			checkNudge(&keyboard);
-		}
-		// set the LED to solid color once
-		if(!connected){
-			connected = true;
-			setLED(0, 255, 0);
-		}
-	// if we've lost the connection then let's blink the LED
-	} else {
-		if (millis() - lastBlink > 500) {
-			lastBlink = millis();
-			ledOn = !ledOn;
-			setLED(0, ledOn ? 255 : 0, 0);
-		}
-		connected = false;
-	}
+#include "arcadeButtonProcessor.hpp"
+#include "ledStripProcessor.hpp"
+#include "accelerometerProcessor.hpp"
+#include "solenoidProcessor.hpp"
+#include "preferencesManager.hpp"
+#include "gameProfiles.hpp"
+#include "serialConsole.hpp"
+#include "traceRecorder.hpp"
+#include "loopProfiler.hpp"
+#include "startupManager.hpp"
+#include "bleConnectionManager.hpp"
+#include "eventBus.hpp"
+#include "taskManager.hpp"
+#include "safetySupervisor.hpp"
+#include "directInputs.hpp"
+#include "inputExpander.hpp"
+#include "powerManager.hpp"
+#include "analogInputs.hpp"
+#include "boardPins.hpp"
+
+#define TIME_IN_MS_HOLD_FOR_MODE_CHANGE 2000
+
+bool connected = false;
+bool ledOn = false;
+bool resetHeld = false;
+bool accelerometerEnabled = false;
+int currentGameMode = 0;
+unsigned long lastBlink = 0;
+unsigned long lastResetPress = 0;
+MPU6050 mpu;
+
+void setLED(uint8_t r, uint8_t g, uint8_t b) {
+	neopixelWrite(PIN_NEOPIXEL, r, g, b);
+}
+
+// Input core: switch closing to HID report, every millisecond
+static void inputStep(){
+	bool linked = outputConnected();
+	serviceSafety(linked);
+	if(linked){
+		processAnalogInputs();
+		processKeyboardButtons();
+	}
+}
+
+static void systemStep();
+
+void setup() {
+	startupBegin();
+	Serial.begin(115200);
+	Serial.println("=== Pinball Controller Starting ===");
+
+	// Solenoids off before anything else
+	pinMode(LEFT_SOLENOID, OUTPUT);
+	pinMode(RIGHT_SOLENOID, OUTPUT);
+	digitalWrite(LEFT_SOLENOID, LOW);
+	digitalWrite(RIGHT_SOLENOID, LOW);
+
+	pinMode(BOOT_BUTTON, INPUT_PULLUP);
+	pinMode(NEOPIXEL_POWER, OUTPUT);
+	pinMode(SR_LOAD, OUTPUT);
+	pinMode(SR_CLK, OUTPUT);
+	pinMode(SR_DATA, INPUT);
+	
+	digitalWrite(NEOPIXEL_POWER, HIGH);
+	digitalWrite(SR_LOAD, HIGH);
+	digitalWrite(SR_CLK, LOW);
+	expanderBegin();
+	switchMatrixBegin();
+	directInputsBegin();   // setup() runs on core 1, so the input interrupts land on the input core
+
+	loadSettings();
+	analogInputsBegin();   // needs the settings store open for its calibration
+	currentGameMode = getControllerMode();
+	selectGameProfile(currentGameMode);
+
+	// Start the output (BLE advertising) as early as possible; accelerometer and LED strip come up from loop()
+	outputBegin();
+	startupAdvertisingStarted();
+
+	traceBegin();
+	startTasks(inputStep, systemStep);
+}
+
+// Everything runs in the input and system tasks
+void loop() {
+	vTaskDelete(NULL);
+}
+
+// System core: console, settings, BLE housekeeping, accelerometer and LEDs
+static void systemStep() {
+	PROFILE_LOOP_BEGIN();
+	serviceSerialConsole();
+	serviceSettings();
+	serviceStartup();
+	serviceBleConnection();
+	serviceLEDStrip();
+	servicePower();
+	PROFILE_STAGE_END(STAGE_CONSOLE);
+
+	if (digitalRead(BOOT_BUTTON) == LOW) {
+		if(lastResetPress == 0){
+			resetHeld = true;
+			lastResetPress = millis();
+		}
+		if(resetHeld){
+			if(millis() - lastResetPress >= TIME_IN_MS_HOLD_FOR_MODE_CHANGE) {
+				switchControllerMode(gotoNextMode(currentGameMode));
+				resetHeld = false; // one switch per hold; play resumes while BOOT is still down
+			} else {
+				return; // we want to exit early so that lastResetPress isn't set to 0
+			}
+		}
+	} else {
+		lastResetPress = 0;
+		resetHeld = false;
+	}
+	PROFILE_STAGE_END(STAGE_BOOT_BUTTON);
+
+	// if we have a bluetooth connection, let's do the important stuff
+	if(outputConnected()){
+		// buttons are handled on the input task; process movement here (but only if accelerometer is enabled)
+		if(accelerometerEnabled) {
+			checkNudge();
+		}
+		PROFILE_STAGE_END(STAGE_NUDGE);
+		// set the LED to solid color once
+		if(!connected){
+			connected = true;
+			setLED(0, 255, 0);
+			publishEvent(EVENT_CONNECTION, 0, 1);
+		}
+	// if we've lost the connection then let's blink the LED
+	} else {
+		if (millis() - lastBlink > 500) {
+			lastBlink = millis();
+			ledOn = !ledOn;
+			setLED(0, ledOn ? 255 : 0, 0);
+		}
+		if(connected) publishEvent(EVENT_CONNECTION, 0, 0);
+		connected = false;
+	}
+	PROFILE_STAGE_END(STAGE_LED_STATUS);
 }
\ No newline at end of file
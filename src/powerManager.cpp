@@ -0,0 +1,62 @@
+#include "powerManager.hpp"
+#include "preferencesManager.hpp"
+#include "eventBus.hpp"
+
+static bool idle = false;
+static unsigned long lastActivity = 0;
+static unsigned long idleSince = 0;
+static unsigned long idleTotalMs = 0;
+static uint32_t idleEntries = 0;
+static uint32_t lastSwitchUs = 0;     // setCpuFrequencyMhz() itself
+static uint32_t lastWakeUs = 0;       // first edge to full clock
+static uint32_t maxWakeUs = 0;
+
+static uint32_t setClock(uint32_t mhz){
+	uint32_t start = micros();
+	setCpuFrequencyMhz(mhz);
+	return micros() - start;
+}
+
+// The edge was already reported at the idle clock; this is how long the input path ran slow
+static void wake(uint32_t edgeTime){
+	lastSwitchUs = setClock(ACTIVE_CPU_MHZ);
+	lastWakeUs = micros() - edgeTime;
+	if (lastWakeUs > maxWakeUs) maxWakeUs = lastWakeUs;
+	idleTotalMs += millis() - idleSince;
+	idle = false;
+}
+
+void servicePower(){
+	static EventSubscriber* activity = subscribeEvents("power",
+		EVENT_MASK(EVENT_BUTTON_EDGE) | EVENT_MASK(EVENT_NUDGE) | EVENT_MASK(EVENT_CONNECTION));
+	Event event;
+	bool active = false;
+	uint32_t firstEdge = 0;
+	while (activity && activity->pop(event)) {
+		if (!active) firstEdge = event.timestamp;
+		active = true;
+	}
+
+	unsigned long now = millis();
+	if (active) {
+		lastActivity = now;
+		if (idle) wake(firstEdge);
+		return;
+	}
+	unsigned long idleAfter = getSetting(SETTING_IDLE_AFTER_S) * 1000UL;
+	if (!idle && idleAfter && now - lastActivity >= idleAfter) {
+		lastSwitchUs = setClock(IDLE_CPU_MHZ);
+		idleSince = now;
+		idleEntries++;
+		idle = true;
+	}
+}
+
+// "power" shows the clock, how much of the time was spent idle and how quickly it woke
+void powerCommand(const char* args){
+	unsigned long now = millis();
+	unsigned long idleMs = idleTotalMs + (idle ? now - idleSince : 0);
+	Serial.printf("%s at %u MHz, idle %lu s of %lu s (%u times)\n", idle ? "Idle" : "Active",
+		getCpuFrequencyMhz(), idleMs / 1000, now / 1000, idleEntries);
+	Serial.printf("Clock switch %u us, wake %u us (max %u)\n", lastSwitchUs, lastWakeUs, maxWakeUs);
+}
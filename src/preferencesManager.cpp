@@ -1,38 +1,171 @@
-#include "preferencesManager.hpp"
-
-Preferences preferences;
-
-int getControllerMode(){
-	preferences.begin("pb", false);
-	int wasSaved = preferences.getInt("wiz");
-	preferences.end();
-	if(wasSaved > 1 || wasSaved < 0) {
-		wasSaved = 0;  // Safety check
-		saveControllerMode(0);
-	}
-	Serial.print("getControllerMode(): ");
-	Serial.println(wasSaved);
-	return wasSaved;
-}
-
-void saveControllerMode(int mode){
-	preferences.begin("pb", false);
-	preferences.putInt("wiz", mode);
-	preferences.end();
-	Serial.print("saveControllerMode with ");
-	Serial.println(mode);
-}
-
-void gotoNextMode(int mode){
-	Serial.println("Calling gotoNextMode()");
-	Serial.print("Saving the following as the next mode: ");
-	Serial.println(mode);
-	if(mode == 0){
-		mode = 1;
-	} else if(mode == 1){
-		mode = 0;
-	} else {
-		Serial.println("huh?");
-	}
-	saveControllerMode(mode);
-}
\ No newline at end of file
+#include "preferencesManager.hpp"
+#include "arcadeButtonProcessor.hpp"
+#include "accelerometerProcessor.hpp"
+#include "ledStripProcessor.hpp"
+#include "safetySupervisor.hpp"
+#include "powerManager.hpp"
+#include "analogPlunger.hpp"
+#include "analogFlippers.hpp"
+#include "analogInputs.hpp"
+#include "axisReporter.hpp"
+#include "inputExpander.hpp"
+#include <nvs.h>
+
+const SettingSchema settingsSchema[NUM_SETTINGS] = {
+	{"wiz",       QUEST_PINBALL_FX_VR,  0,                   NUM_GAME_MODES - 1},
+	{"debounce",  DEBOUNCE_MS,          1,                   50},
+	{"nudgeThr",  NUDGE_THRESHOLD,      1000,                32000},
+	{"nudgePress",NUDGE_PRESS_TIME,     10,                  500},
+	{"nudgeCool", NUDGE_COOLDOWN,       0,                   2000},
+	{"ledBright", LED_STRIP_BRIGHTNESS, 0,                   255},
+	{"keyLimit",  KEY_HOLD_LIMIT_S,     0,                   3600},
+	{"coilLimit", COIL_HOLD_LIMIT_MS,   0,                   60000},
+	{"idleAfter", IDLE_AFTER_S,         0,                   3600},
+	{"plunger",   PLUNGER_MODE_DEFAULT, PLUNGER_OFF,         PLUNGER_AXIS},
+	{"flipPress", FLIPPER_PRESS_POINT,  1,                   ANALOG_FULL_SCALE},
+	{"flipHyst",  FLIPPER_HYSTERESIS,   0,                   255},
+	{"axisEps",   AXIS_EPSILON,         1,                   64},
+	{"axisRefresh",AXIS_REFRESH_MS,     1,                   1000},
+	{"xpPulses",  EXPANDER_PULSE_DEFAULT, EXPANDER_PULSE_BOUNCE, EXPANDER_PULSE_PRESS}
+};
+
+int32_t settingValues[NUM_SETTINGS];
+
+static nvs_handle_t settingsHandle = 0;
+static bool settingsOpen = false;
+static uint32_t dirtySettings = 0;    // one bit per SETTING
+static portMUX_TYPE settingsMux = portMUX_INITIALIZER_UNLOCKED;   // settings change on both tasks
+static unsigned long lastSettingChange = 0;
+
+static bool inRange(SETTING id, int32_t value){
+	return value >= settingsSchema[id].minValue && value <= settingsSchema[id].maxValue;
+}
+
+// Opens the namespace once and keeps it open; every setting is read into RAM here
+void loadSettings(){
+	esp_err_t err = nvs_open(SETTINGS_NAMESPACE, NVS_READWRITE, &settingsHandle);
+	settingsOpen = (err == ESP_OK);
+	if (!settingsOpen) {
+		Serial.printf("Settings namespace unavailable (%s), using defaults\n", esp_err_to_name(err));
+	}
+
+	for (uint8_t i = 0; i < NUM_SETTINGS; i++) {
+		int32_t value = settingsSchema[i].defaultValue;
+		if (settingsOpen && nvs_get_i32(settingsHandle, settingsSchema[i].key, &value) == ESP_OK
+				&& !inRange((SETTING)i, value)) {
+			Serial.printf("Setting %s=%d out of range, resetting\n", settingsSchema[i].key, value);
+			value = settingsSchema[i].defaultValue;
+			dirtySettings |= (1UL << i);
+		}
+		settingValues[i] = value;
+	}
+}
+
+// Updates RAM immediately; the write to flash is deferred and batched by serviceSettings()
+bool setSetting(SETTING id, int32_t value){
+	if (!inRange(id, value)) return false;
+	if (settingValues[id] == value) return true;
+	settingValues[id] = value;
+	portENTER_CRITICAL(&settingsMux);
+	dirtySettings |= (1UL << id);
+	lastSettingChange = millis();
+	portEXIT_CRITICAL(&settingsMux);
+	return true;
+}
+
+// Writes every dirty setting and commits them together
+void flushSettings(){
+	if (!dirtySettings || !settingsOpen) return;
+	portENTER_CRITICAL(&settingsMux);
+	uint32_t dirty = dirtySettings;
+	dirtySettings = 0;
+	portEXIT_CRITICAL(&settingsMux);
+	for (uint8_t i = 0; i < NUM_SETTINGS; i++) {
+		if (dirty & (1UL << i)) {
+			nvs_set_i32(settingsHandle, settingsSchema[i].key, settingValues[i]);
+		}
+	}
+	esp_err_t err = nvs_commit(settingsHandle);
+	if (err != ESP_OK) {
+		Serial.printf("Settings commit failed (%s)\n", esp_err_to_name(err));
+		portENTER_CRITICAL(&settingsMux);
+		dirtySettings |= dirty;
+		portEXIT_CRITICAL(&settingsMux);
+	}
+}
+
+void serviceSettings(){
+	if (dirtySettings && (millis() - lastSettingChange >= SETTINGS_FLUSH_DELAY_MS)) {
+		flushSettings();
+	}
+}
+
+// Only succeeds when the stored blob has exactly the expected size, so a layout change falls back to defaults
+bool loadSettingsBlob(const char* key, void* data, size_t length){
+	if (!settingsOpen) return false;
+	size_t stored = 0;
+	if (nvs_get_blob(settingsHandle, key, nullptr, &stored) != ESP_OK || stored != length) return false;
+	return nvs_get_blob(settingsHandle, key, data, &stored) == ESP_OK;
+}
+
+void saveSettingsBlob(const char* key, const void* data, size_t length){
+	if (!settingsOpen) return;
+	if (nvs_set_blob(settingsHandle, key, data, length) != ESP_OK || nvs_commit(settingsHandle) != ESP_OK) {
+		Serial.printf("Saving %s failed\n", key);
+	}
+}
+
+void eraseSettingsBlob(const char* key){
+	if (!settingsOpen) return;
+	nvs_erase_key(settingsHandle, key);
+	nvs_commit(settingsHandle);
+}
+
+// "set" lists every setting, "set <key> <value>" changes one
+void settingsCommand(const char* args){
+	if (*args == '\0') {
+		for (uint8_t i = 0; i < NUM_SETTINGS; i++) {
+			const SettingSchema& schema = settingsSchema[i];
+			Serial.printf("%-12s %6d  [%d..%d]%s\n", schema.key, settingValues[i],
+				schema.minValue, schema.maxValue, (dirtySettings & (1UL << i)) ? " *" : "");
+		}
+		return;
+	}
+	char key[16];
+	long value;
+	if (sscanf(args, "%15s %ld", key, &value) != 2) {
+		Serial.println("usage: set <key> <value>");
+		return;
+	}
+	for (uint8_t i = 0; i < NUM_SETTINGS; i++) {
+		if (strcmp(key, settingsSchema[i].key) == 0) {
+			if (!setSetting((SETTING)i, value)) {
+				Serial.printf("%s must be %d..%d\n", key, settingsSchema[i].minValue, settingsSchema[i].maxValue);
+			}
+			return;
+		}
+	}
+	Serial.printf("Unknown setting '%s'\n", key);
+}
+
+int getControllerMode(){
+	int mode = getSetting(SETTING_CONTROLLER_MODE);
+	Serial.print("getControllerMode(): ");
+	Serial.println(mode);
+	return mode;
+}
+
+void saveControllerMode(int mode){
+	setSetting(SETTING_CONTROLLER_MODE, mode);
+	Serial.print("saveControllerMode with ");
+	Serial.println(mode);
+}
+
+int gotoNextMode(int mode){
+	Serial.println("Calling gotoNextMode()");
+	Serial.print("Saving the following as the next mode: ");
+	Serial.println(mode);
+	mode = (mode + 1) % NUM_GAME_MODES;
+	saveControllerMode(mode);
+	return mode;
+}
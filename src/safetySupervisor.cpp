@@ -0,0 +1,64 @@
+#include "safetySupervisor.hpp"
+#include "keyArbiter.hpp"
+#include "solenoidProcessor.hpp"
+#include "arcadeButtonProcessor.hpp"
+#include "preferencesManager.hpp"
+
+static bool wasConnected = false;
+static uint32_t releaseCounts[NUM_RELEASE_REASONS];
+static uint32_t resyncs = 0;
+
+void forceReleaseAll(uint8_t reason){
+	releaseAllKeys();
+	for (uint8_t coil = 0; coil < NUM_COILS; coil++) {
+		releaseCoil(coil);
+	}
+	releaseCounts[reason]++;
+}
+
+static void checkHoldLimits(unsigned long now){
+	unsigned long keyLimit = getSetting(SETTING_KEY_HOLD_LIMIT_S) * 1000UL;
+	for (uint8_t owner = 0; owner < NUM_KEY_OWNERS && keyLimit && holdingOwnerCount(); owner++) {
+		if (!ownerHolding(owner) || now - ownerHeldSince(owner) < keyLimit) continue;
+		releaseOwner(owner);
+		releaseCounts[RELEASE_KEY_TIMEOUT]++;
+	}
+
+	unsigned long coilLimit = getSetting(SETTING_COIL_HOLD_LIMIT_MS);
+	for (uint8_t coil = 0; coil < NUM_COILS && coilLimit; coil++) {
+		if (!coilEnergized(coil) || now - coilOnSince(coil) < coilLimit) continue;
+		releaseCoil(coil);
+		releaseCounts[RELEASE_COIL_TIMEOUT]++;
+	}
+}
+
+void serviceSafety(bool connected){
+	if (connected != wasConnected) {
+		wasConnected = connected;
+		if (connected) {
+			// Buttons weren't scanned while the link was down; whatever is held now gets pressed
+			// on the next scan, so the host starts from the real state
+			resetButtonStates();
+			resyncs++;
+		} else {
+			forceReleaseAll(RELEASE_DISCONNECT);
+			resetButtonStates();
+		}
+	}
+	checkHoldLimits(millis());
+}
+
+// "safety" shows what is held right now and how often the supervisor had to step in
+void safetyCommand(const char* args){
+	static const char* const reasonNames[NUM_RELEASE_REASONS] = {"disconnect", "mode change", "key timeout", "coil timeout"};
+	unsigned long now = millis();
+	Serial.printf("Link %s, %u resyncs\n", wasConnected ? "up" : "down", resyncs);
+	for (uint8_t coil = 0; coil < NUM_COILS; coil++) {
+		if (coilEnergized(coil)) Serial.printf("Coil %u on for %lu ms\n", coil, now - coilOnSince(coil));
+		else Serial.printf("Coil %u off\n", coil);
+	}
+	Serial.printf("%u sources holding keys\n", holdingOwnerCount());
+	for (uint8_t reason = 0; reason < NUM_RELEASE_REASONS; reason++) {
+		Serial.printf("%-12s %u releases\n", reasonNames[reason], releaseCounts[reason]);
+	}
+}
@@ -0,0 +1,84 @@
+#include "serialConsole.hpp"
+#include "traceRecorder.hpp"
+#include "inputBenchmark.hpp"
+#include "loopProfiler.hpp"
+#include "preferencesManager.hpp"
+#include "arcadeButtonProcessor.hpp"
+#include "gameProfiles.hpp"
+#include "startupManager.hpp"
+#include "bleConnectionManager.hpp"
+#include "eventBus.hpp"
+#include "taskManager.hpp"
+#include "keyArbiter.hpp"
+#include "safetySupervisor.hpp"
+#include "directInputs.hpp"
+#include "inputExpander.hpp"
+#include "powerManager.hpp"
+#include "analogInputs.hpp"
+
+static void helpCommand(const char* args);
+
+const ConsoleCommand consoleCommands[] = {
+	{"help",  helpCommand},
+	{"trace", traceCommand},
+	{"bench", benchCommand},
+	{"prof",  profileCommand},
+	{"set",   settingsCommand},
+	{"map",   mapCommand},
+	{"mode",  modeCommand},
+	{"boot",  bootCommand},
+	{"ble",   bleCommand},
+	{"bus",   busCommand},
+	{"tasks", tasksCommand},
+	{"keys",  keysCommand},
+	{"safety",safetyCommand},
+	{"direct",directCommand},
+	{"expander",expanderCommand},
+	{"matrix",matrixCommand},
+	{"power", powerCommand},
+	{"analog",analogCommand}
+};
+
+const uint8_t NUM_CONSOLE_COMMANDS = sizeof(consoleCommands) / sizeof(ConsoleCommand);
+
+static char lineBuffer[CONSOLE_LINE_LENGTH];
+static uint8_t lineLength = 0;
+
+static void helpCommand(const char* args){
+	Serial.print("Commands:");
+	for (uint8_t i = 0; i < NUM_CONSOLE_COMMANDS; i++) {
+		Serial.print(' ');
+		Serial.print(consoleCommands[i].name);
+	}
+	Serial.println();
+}
+
+static void runCommand(char* line){
+	char* args = strchr(line, ' ');
+	if (args) {
+		*args++ = '\0';
+	} else {
+		args = line + strlen(line);
+	}
+	for (uint8_t i = 0; i < NUM_CONSOLE_COMMANDS; i++) {
+		if (strcmp(line, consoleCommands[i].name) == 0) {
+			consoleCommands[i].handler(args);
+			return;
+		}
+	}
+	Serial.printf("Unknown command '%s'\n", line);
+}
+
+void serviceSerialConsole(){
+	while (Serial.available()) {
+		char c = Serial.read();
+		if (c == '\r' || c == '\n') {
+			if (lineLength == 0) continue;
+			lineBuffer[lineLength] = '\0';
+			lineLength = 0;
+			runCommand(lineBuffer);
+		} else if (lineLength < CONSOLE_LINE_LENGTH - 1) {
+			lineBuffer[lineLength++] = c;
+		}
+	}
+}
@@ -1,17 +1,40 @@
-#include "solenoidProcessor.hpp"
-
-void sendLeftFlipperDataHigh(){
-	digitalWrite(LEFT_SOLENOID, HIGH);
-}
-
-void sendRightFlipperDataHigh(){
-	digitalWrite(RIGHT_SOLENOID, HIGH);
-}
-
-void sendLeftFlipperDataLow(){
-	digitalWrite(LEFT_SOLENOID, LOW);
-}
-
-void sendRightFlipperDataLow(){
-	digitalWrite(RIGHT_SOLENOID, LOW);
-}
\ No newline at end of file
+#include "solenoidProcessor.hpp"
+
+static const uint8_t coilPins[NUM_COILS] = {LEFT_SOLENOID, RIGHT_SOLENOID};
+static bool energized[NUM_COILS] = {false, false};
+static unsigned long onSince[NUM_COILS] = {0, 0};
+
+static void energizeCoil(uint8_t coil){
+	digitalWrite(coilPins[coil], HIGH);
+	if (!energized[coil]) onSince[coil] = millis();
+	energized[coil] = true;
+}
+
+void releaseCoil(uint8_t coil){
+	digitalWrite(coilPins[coil], LOW);
+	energized[coil] = false;
+}
+
+bool coilEnergized(uint8_t coil){
+	return energized[coil];
+}
+
+unsigned long coilOnSince(uint8_t coil){
+	return onSince[coil];
+}
+
+void sendLeftFlipperDataHigh(){
+	energizeCoil(COIL_LEFT);
+}
+
+void sendRightFlipperDataHigh(){
+	energizeCoil(COIL_RIGHT);
+}
+
+void sendLeftFlipperDataLow(){
+	releaseCoil(COIL_LEFT);
+}
+
+void sendRightFlipperDataLow(){
+	releaseCoil(COIL_RIGHT);
+}
@@ -0,0 +1,57 @@
+#include "startupManager.hpp"
+#include "accelerometerProcessor.hpp"
+#include "ledStripProcessor.hpp"
+#include "inputBenchmark.hpp"
+
+extern int currentGameMode;
+
+static STARTUP_STAGE startupStage = STARTUP_ACCELEROMETER;
+
+// All in microseconds since the app started
+static unsigned long setupMicros = 0;
+static unsigned long advertisingMicros = 0;
+static unsigned long readyMicros = 0;
+
+static void printBootTimes(){
+	Serial.printf("Boot: setup %lu ms, advertising %lu ms, ready %lu ms\n",
+		setupMicros / 1000, advertisingMicros / 1000, readyMicros / 1000);
+}
+
+void startupBegin(){
+	setupMicros = micros();
+	startupStage = STARTUP_ACCELEROMETER;
+}
+
+void startupAdvertisingStarted(){
+	advertisingMicros = micros();
+}
+
+void serviceStartup(){
+	switch (startupStage) {
+		case STARTUP_ACCELEROMETER:
+			startupStage = tryToStartAccelerometer() ? STARTUP_CALIBRATION : STARTUP_LED_STRIP;
+			break;
+		case STARTUP_CALIBRATION:
+			if (serviceAccelerometerCalibration()) startupStage = STARTUP_LED_STRIP;
+			break;
+		case STARTUP_LED_STRIP:
+			setLEDStrip(currentGameMode);
+			readyMicros = micros();
+			startupStage = STARTUP_DONE;
+			printBootTimes();
+#ifdef INPUT_BENCHMARK
+			runInputBenchmarks();
+#endif
+			break;
+		case STARTUP_DONE:
+			break;
+	}
+}
+
+bool startupComplete(){
+	return startupStage == STARTUP_DONE;
+}
+
+void bootCommand(const char* args){
+	printBootTimes();
+}
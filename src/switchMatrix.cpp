@@ -0,0 +1,93 @@
+#include "switchMatrix.hpp"
+
+#ifdef SWITCH_MATRIX
+
+#include "arcadeButtonProcessor.hpp"
+#include <soc/gpio_reg.h>
+
+static_assert(MATRIX_ROW_A0 < 32 && MATRIX_ROW_A1 < 32 && MATRIX_ROW_A2 < 32,
+	"row select pins must be in the first GPIO bank");
+
+// Set and clear masks for each row's address, worked out once so selecting a row is two register writes
+static uint32_t rowSet[MATRIX_ROWS];
+static uint32_t rowClear[MATRIX_ROWS];
+
+static uint8_t lastRows[MATRIX_ROWS];     // closed switches per row, 1 = closed
+static uint32_t ghostScans = 0;
+static uint32_t lastScanUs = 0;
+static uint32_t maxScanUs = 0;
+
+void switchMatrixBegin(){
+	static const uint8_t addressPins[3] = {MATRIX_ROW_A0, MATRIX_ROW_A1, MATRIX_ROW_A2};
+	for (uint8_t i = 0; i < 3; i++) {
+		pinMode(addressPins[i], OUTPUT);
+	}
+	for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+		rowSet[row] = rowClear[row] = 0;
+		for (uint8_t i = 0; i < 3; i++) {
+			if (row & (1 << i)) rowSet[row] |= (1UL << addressPins[i]);
+			else rowClear[row] |= (1UL << addressPins[i]);
+		}
+	}
+	memset(lastRows, 0, sizeof(lastRows));
+}
+
+// Without a diode (or with a failed one) three closed corners of a rectangle make the fourth read
+// closed too. Two rows sharing two or more closed columns can't be told apart from a ghost, so both
+// keep their previous reading until one of the switches opens
+static void rejectGhosts(uint8_t* rows){
+	uint8_t ambiguous = 0;
+	for (uint8_t a = 0; a < MATRIX_ROWS; a++) {
+		if (!rows[a]) continue;
+		for (uint8_t b = a + 1; b < MATRIX_ROWS; b++) {
+			uint8_t shared = rows[a] & rows[b];
+			if (shared & (shared - 1)) ambiguous |= (1 << a) | (1 << b);
+		}
+	}
+	if (!ambiguous) return;
+	ghostScans++;
+	for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+		if (ambiguous & (1 << row)) rows[row] = lastRows[row];
+	}
+}
+
+uint64_t scanSwitchMatrix(){
+	uint32_t start = micros();
+	uint8_t rows[MATRIX_ROWS];
+	for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+		REG_WRITE(GPIO_OUT_W1TS_REG, rowSet[row]);
+		REG_WRITE(GPIO_OUT_W1TC_REG, rowClear[row]);
+		delayMicroseconds(MATRIX_SETTLE_US);
+		rows[row] = ~readShiftRegister();
+	}
+	rejectGhosts(rows);
+
+	uint64_t raw = 0;
+	for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+		lastRows[row] = rows[row];
+		raw |= (uint64_t)(uint8_t)~rows[row] << (row * 8);
+	}
+	lastScanUs = micros() - start;
+	if (lastScanUs > maxScanUs) maxScanUs = lastScanUs;
+	return raw;
+}
+
+// "matrix" draws the closed switches and the scan cost
+void matrixCommand(const char* args){
+	for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+		Serial.printf("row %u ", row);
+		for (uint8_t column = 0; column < 8; column++) {
+			Serial.print((lastRows[row] & (1 << column)) ? 'X' : '.');
+		}
+		Serial.println();
+	}
+	Serial.printf("Scan %u us (max %u), %u scans with ghosting\n", lastScanUs, maxScanUs, ghostScans);
+}
+
+#else
+
+void matrixCommand(const char* args){
+	Serial.println("Switch matrix disabled; build with SWITCH_MATRIX");
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include "taskManager.hpp"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+// Written only by the task it describes; the console copies it, so a torn read just
+// shows a slightly stale number
+struct TaskStats {
+	uint32_t runs;
+	uint32_t maxJitterUs;        // deviation of the start-to-start interval from the period
+	uint64_t totalJitterUs;
+	uint32_t maxRunUs;
+	uint64_t busyUs;
+	uint32_t overruns;           // runs longer than the period
+	int64_t since;               // esp_timer_get_time() when the stats were last reset; 64 bits so the
+	                             // load stays right past micros() wrapping every 71 minutes
+};
+
+struct AppTask {
+	const char* name;
+	void (*step)();
+	uint8_t core;
+	uint8_t priority;
+	uint32_t periodMs;
+	uint32_t stackSize;
+	TaskHandle_t handle;
+	volatile bool resetRequested;
+	TaskStats stats;
+};
+
+static AppTask appTasks[NUM_APP_TASKS] = {
+	{"input",  nullptr, INPUT_TASK_CORE,  INPUT_TASK_PRIORITY,  INPUT_TASK_PERIOD_MS,  INPUT_TASK_STACK,  nullptr, false, {}},
+	{"system", nullptr, SYSTEM_TASK_CORE, SYSTEM_TASK_PRIORITY, SYSTEM_TASK_PERIOD_MS, SYSTEM_TASK_STACK, nullptr, false, {}}
+};
+
+// Single-slot mailbox from the system task to the input task
+static portMUX_TYPE jobMux = portMUX_INITIALIZER_UNLOCKED;
+static void (*volatile pendingJob)(const char*) = nullptr;
+static const char* pendingArgs = nullptr;
+static TaskHandle_t jobCaller = nullptr;
+
+static void runPendingJob(){
+	if (!pendingJob) return;
+	portENTER_CRITICAL(&jobMux);
+	void (*job)(const char*) = pendingJob;
+	const char* args = pendingArgs;
+	TaskHandle_t caller = jobCaller;
+	portEXIT_CRITICAL(&jobMux);
+
+	job(args);
+
+	pendingJob = nullptr;
+	xTaskNotifyGive(caller);
+}
+
+static void periodicTask(void* param){
+	AppTask& task = *(AppTask*)param;
+	TaskStats& stats = task.stats;
+	const uint32_t periodUs = task.periodMs * 1000;
+	TickType_t lastWake = xTaskGetTickCount();
+	uint32_t lastStart = 0;
+	stats.since = esp_timer_get_time();
+
+	while (true) {
+		vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(task.periodMs));
+		uint32_t start = micros();
+		if (task.resetRequested) {
+			memset(&stats, 0, sizeof(stats));
+			stats.since = esp_timer_get_time();
+			task.resetRequested = false;
+		} else if (stats.runs > 0) {
+			uint32_t interval = start - lastStart;
+			uint32_t jitter = (interval > periodUs) ? interval - periodUs : periodUs - interval;
+			stats.totalJitterUs += jitter;
+			if (jitter > stats.maxJitterUs) stats.maxJitterUs = jitter;
+		}
+		lastStart = start;
+
+		task.step();
+		if (&task == &appTasks[TASK_INPUT]) runPendingJob();
+
+		uint32_t run = micros() - start;
+		stats.busyUs += run;
+		if (run > stats.maxRunUs) stats.maxRunUs = run;
+		if (run > periodUs) stats.overruns++;
+		stats.runs++;
+	}
+}
+
+void startTasks(void (*inputStep)(), void (*systemStep)()){
+	appTasks[TASK_INPUT].step = inputStep;
+	appTasks[TASK_SYSTEM].step = systemStep;
+	for (uint8_t i = 0; i < NUM_APP_TASKS; i++) {
+		AppTask& task = appTasks[i];
+		if (xTaskCreatePinnedToCore(periodicTask, task.name, task.stackSize, &task, task.priority,
+				&task.handle, task.core) != pdPASS) {
+			Serial.printf("Failed to start %s task!\n", task.name);
+		}
+	}
+}
+
+void runOnInputTask(void (*job)(const char* args), const char* args){
+	TaskHandle_t inputHandle = appTasks[TASK_INPUT].handle;
+	if (!inputHandle || xTaskGetCurrentTaskHandle() == inputHandle) {
+		job(args);
+		return;
+	}
+	portENTER_CRITICAL(&jobMux);
+	pendingArgs = args;
+	jobCaller = xTaskGetCurrentTaskHandle();
+	pendingJob = job;
+	portEXIT_CRITICAL(&jobMux);
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+// "tasks" prints per task timing and CPU load, "tasks reset" restarts the measurement
+void tasksCommand(const char* args){
+	if (strcmp(args, "reset") == 0) {
+		for (uint8_t i = 0; i < NUM_APP_TASKS; i++) appTasks[i].resetRequested = true;
+		Serial.println("Task stats reset");
+		return;
+	}
+
+	Serial.printf("%-7s %4s %4s %9s %8s %8s %8s %8s %6s %9s %10s\n", "task", "core", "prio", "runs",
+		"avg us", "max us", "jit avg", "jit max", "cpu %", "overruns", "stack free");
+	int64_t now = esp_timer_get_time();
+	for (uint8_t i = 0; i < NUM_APP_TASKS; i++) {
+		const AppTask& task = appTasks[i];
+		if (!task.handle) {
+			Serial.printf("%-7s not running\n", task.name);
+			continue;
+		}
+		TaskStats stats = task.stats;
+		uint64_t window = now - stats.since;
+		uint32_t avgRun = stats.runs ? stats.busyUs / stats.runs : 0;
+		uint32_t avgJitter = (stats.runs > 1) ? stats.totalJitterUs / (stats.runs - 1) : 0;
+		float load = window ? (stats.busyUs * 100.0f) / window : 0;
+		Serial.printf("%-7s %4u %4u %9u %8u %8u %8u %8u %6.1f %9u %10u\n", task.name, task.core, task.priority,
+			stats.runs, avgRun, stats.maxRunUs, avgJitter, stats.maxJitterUs, load, stats.overruns,
+			uxTaskGetStackHighWaterMark(task.handle));
+	}
+}
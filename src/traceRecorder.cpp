@@ -0,0 +1,226 @@
+#include "traceRecorder.hpp"
+
+#ifdef TRACE_CAPTURE
+
+#include <freertos/FreeRTOS.h>
+
+// Largest record: type + 5 byte delta + 10 byte raw input word (64 inputs with SWITCH_MATRIX)
+#define TRACE_MAX_RECORD   16
+// Block header: absolute start time (u32) + bytes used (u16)
+#define TRACE_BLOCK_HEADER 6
+
+static portMUX_TYPE traceMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t* traceBuffer = nullptr;
+static uint16_t blockCount = 0;
+static uint16_t headBlock = 0;       // block currently being written
+static uint16_t oldestBlock = 0;
+static uint16_t writePos = 0;        // offset inside headBlock
+static uint32_t lastTime = 0;        // timestamp of previous record in headBlock
+static uint32_t droppedBlocks = 0;
+static bool tracePaused = false;     // set under traceMux, so no record is half written while it holds
+
+// Every raw value is a valid input word (all ones is everything released), so "nothing traced yet"
+// is a flag rather than a sentinel value; the first word after boot or a clear always goes in
+static bool rawTraced = false;
+static uint64_t lastRawTraced = 0;
+static int16_t lastAccel[3] = {0, 0, 0};
+
+static inline uint8_t* blockAt(uint16_t block){
+	return traceBuffer + (uint32_t)block * TRACE_BLOCK_SIZE;
+}
+
+static inline void putU32(uint8_t* p, uint32_t v){
+	p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static inline void putU16(uint8_t* p, uint16_t v){
+	p[0] = v; p[1] = v >> 8;
+}
+
+static inline uint8_t* putVarint(uint8_t* p, uint32_t v){
+	while (v >= 0x80) {
+		*p++ = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (uint8_t)v;
+	return p;
+}
+
+static inline uint8_t* putVarint64(uint8_t* p, uint64_t v){
+	while (v >= 0x80) {
+		*p++ = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (uint8_t)v;
+	return p;
+}
+
+static inline uint32_t zigzag(int32_t v){
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static void startBlock(uint16_t block, uint32_t now){
+	putU32(blockAt(block), now);
+	putU16(blockAt(block) + 4, 0);
+	writePos = TRACE_BLOCK_HEADER;
+	lastTime = now;
+	lastAccel[0] = lastAccel[1] = lastAccel[2] = 0;
+}
+
+// Must be called inside traceMux. Returns the write pointer for a new record,
+// moving to the next block (and dropping the oldest one) when the current block is full.
+static uint8_t* beginRecord(uint8_t type, uint32_t now){
+	if (writePos + TRACE_MAX_RECORD > TRACE_BLOCK_SIZE) {
+		headBlock = (headBlock + 1) % blockCount;
+		if (headBlock == oldestBlock) {
+			oldestBlock = (oldestBlock + 1) % blockCount;
+			droppedBlocks++;
+		}
+		startBlock(headBlock, now);
+	}
+	uint8_t* p = blockAt(headBlock) + writePos;
+	*p++ = type;
+	p = putVarint(p, now - lastTime);
+	lastTime = now;
+	return p;
+}
+
+static inline void endRecord(uint8_t* p){
+	writePos = p - blockAt(headBlock);
+	putU16(blockAt(headBlock) + 4, writePos - TRACE_BLOCK_HEADER);
+}
+
+void traceBegin(){
+	uint32_t size = TRACE_BUFFER_SIZE_HEAP;
+	if (psramFound()) {
+		traceBuffer = (uint8_t*)ps_malloc(TRACE_BUFFER_SIZE_PSRAM);
+		size = TRACE_BUFFER_SIZE_PSRAM;
+	}
+	if (!traceBuffer) {
+		traceBuffer = (uint8_t*)malloc(TRACE_BUFFER_SIZE_HEAP);
+		size = TRACE_BUFFER_SIZE_HEAP;
+	}
+	if (!traceBuffer) {
+		Serial.println("Trace buffer allocation failed!");
+		return;
+	}
+	blockCount = size / TRACE_BLOCK_SIZE;
+	startBlock(0, micros());
+	Serial.printf("Trace capture enabled: %u blocks of %u bytes\n", blockCount, TRACE_BLOCK_SIZE);
+}
+
+void traceRawInput(uint64_t raw){
+	if (!traceBuffer || (rawTraced && raw == lastRawTraced)) return;
+	uint32_t now = micros();
+	portENTER_CRITICAL(&traceMux);
+	if (tracePaused) {
+		portEXIT_CRITICAL(&traceMux);
+		return;
+	}
+	rawTraced = true;
+	lastRawTraced = raw;
+	uint8_t* p = beginRecord(TRACE_RAW_INPUT, now);
+	p = putVarint64(p, raw);
+	endRecord(p);
+	portEXIT_CRITICAL(&traceMux);
+}
+
+void traceAccelSample(int16_t x, int16_t y, int16_t z){
+	if (!traceBuffer) return;
+	uint32_t now = micros();
+	portENTER_CRITICAL(&traceMux);
+	if (tracePaused) {
+		portEXIT_CRITICAL(&traceMux);
+		return;
+	}
+	uint8_t* p = beginRecord(TRACE_ACCEL, now);
+	p = putVarint(p, zigzag(x - lastAccel[0]));
+	p = putVarint(p, zigzag(y - lastAccel[1]));
+	p = putVarint(p, zigzag(z - lastAccel[2]));
+	lastAccel[0] = x;
+	lastAccel[1] = y;
+	lastAccel[2] = z;
+	endRecord(p);
+	portEXIT_CRITICAL(&traceMux);
+}
+
+void traceHidEvent(uint8_t key, bool pressed){
+	if (!traceBuffer) return;
+	uint32_t now = micros();
+	portENTER_CRITICAL(&traceMux);
+	if (tracePaused) {
+		portEXIT_CRITICAL(&traceMux);
+		return;
+	}
+	uint8_t* p = beginRecord(pressed ? TRACE_HID_PRESS : TRACE_HID_RELEASE, now);
+	*p++ = key;
+	endRecord(p);
+	portEXIT_CRITICAL(&traceMux);
+}
+
+static uint16_t usedBlocks(){
+	return ((headBlock + blockCount - oldestBlock) % blockCount) + 1;
+}
+
+static void traceClear(){
+	portENTER_CRITICAL(&traceMux);
+	headBlock = 0;
+	oldestBlock = 0;
+	droppedBlocks = 0;
+	rawTraced = false;
+	startBlock(0, micros());
+	portEXIT_CRITICAL(&traceMux);
+}
+
+// Binary dump, decoded on the host by tools/decode_trace.py:
+//   "PWTR" u8 version, u16 blockCount, u16 blockSize, u32 droppedBlocks
+//   per block: u32 startMicros, u16 usedBytes, usedBytes of records
+// Recording stops for the length of the dump; pausing inside the lock waits out any record being
+// written, and the ring position is read once, so the blocks sent are the ones the header counts
+static void traceDump(){
+	portENTER_CRITICAL(&traceMux);
+	tracePaused = true;
+	uint16_t blocks = usedBlocks();
+	uint16_t first = oldestBlock;
+	uint32_t dropped = droppedBlocks;
+	portEXIT_CRITICAL(&traceMux);
+
+	uint8_t header[13] = {'P', 'W', 'T', 'R', TRACE_FORMAT_VERSION};
+	putU16(header + 5, blocks);
+	putU16(header + 7, TRACE_BLOCK_SIZE);
+	putU32(header + 9, dropped);
+	Serial.write(header, sizeof(header));
+	for (uint16_t i = 0; i < blocks; i++) {
+		uint8_t* block = blockAt((first + i) % blockCount);
+		uint16_t used = block[4] | (block[5] << 8);
+		Serial.write(block, TRACE_BLOCK_HEADER + used);
+	}
+	Serial.flush();
+
+	portENTER_CRITICAL(&traceMux);
+	tracePaused = false;
+	portEXIT_CRITICAL(&traceMux);
+}
+
+void traceCommand(const char* args){
+	if (!traceBuffer) {
+		Serial.println("Trace buffer not allocated");
+	} else if (strcmp(args, "dump") == 0) {
+		traceDump();
+	} else if (strcmp(args, "clear") == 0) {
+		traceClear();
+		Serial.println("Trace cleared");
+	} else {
+		Serial.printf("Trace: %u/%u blocks used, %u dropped (usage: trace dump|clear)\n",
+			usedBlocks(), blockCount, droppedBlocks);
+	}
+}
+
+#else
+
+void traceCommand(const char* args){
+	Serial.println("Trace capture disabled; build with TRACE_CAPTURE");
+}
+
+#endif
@@ -0,0 +1,114 @@
+#include <unity.h>
+#include <chrono>
+#include "arcadeButtonProcessor.hpp"
+#include "gameProfiles.hpp"
+#include "keyArbiter.hpp"
+#include "axisReporter.hpp"
+#include "eventBus.hpp"
+#include "hidOutput.hpp"
+#include "nativeDoubles.h"
+
+// The input hot path on the host, timed with the host clock: the same work as the device's
+// "bench" rows that don't need hardware, for comparing changes without flashing a board.
+// Host numbers are not device numbers; compare them only with each other
+#define BENCH_ITERATIONS   100000
+
+extern InputWord stableState;
+
+struct BenchResult {
+	uint64_t minNs;
+	uint64_t maxNs;
+	uint64_t totalNs;
+};
+
+static InputWord benchRaw;
+static bool benchKeyDown = false;
+
+static void benchEmpty(){
+}
+
+// Raw matches the debounced state: the cost every idle scan pays
+static void benchDebounceSteady(){
+	updateButtonStates(stableState, millis());
+}
+
+// Every mapped bit changes each call, resetting the debounce timers without reaching an edge
+static void benchDebounceBouncing(){
+	benchRaw = ~benchRaw;
+	updateButtonStates(benchRaw, millis());
+}
+
+// A full flipper edge: scan, arbiter and report, pressed and released on alternate calls
+static void benchFlipperEdge(){
+	benchKeyDown = !benchKeyDown;
+	updateButtonStates(benchKeyDown ? (InputWord)~INPUT_BIT(BTN_BIT_LFLIPPER) : (InputWord)~(InputWord)0, millis());
+	fakeOutputClear();
+}
+
+// A nudge start or end drained by the scan
+static void benchNudge(){
+	benchKeyDown = !benchKeyDown;
+	publishEvent(EVENT_NUDGE, KEY_LMAGNASAVE_QPVR, benchKeyDown);
+	updateButtonStates(stableState, millis());
+	fakeOutputClear();
+}
+
+// All three axes moving, one report per call
+static void benchAxisFlush(){
+	benchKeyDown = !benchKeyDown;
+	int8_t value = benchKeyDown ? 100 : -100;
+	for (uint8_t axis = 0; axis < NUM_PAD_AXES; axis++) reportAxis(axis, value);
+	flushAxisReports();
+	fakeOutputClear();
+}
+
+static BenchResult measure(void (*fn)(), uint32_t iterations){
+	BenchResult result = {UINT64_MAX, 0, 0};
+	for (uint32_t i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		if (ns < result.minNs) result.minNs = ns;
+		if (ns > result.maxNs) result.maxNs = ns;
+		result.totalNs += ns;
+	}
+	return result;
+}
+
+static void printRow(const char* name, void (*fn)()){
+	BenchResult result = measure(fn, BENCH_ITERATIONS);
+	printf("%-24s %8u %8llu %8llu %8llu\n", name, BENCH_ITERATIONS, (unsigned long long)result.minNs,
+		(unsigned long long)(result.totalNs / BENCH_ITERATIONS), (unsigned long long)result.maxNs);
+	// Every edge benchmark runs an even number of calls, so nothing is left held
+	TEST_ASSERT_EQUAL_UINT8(0, holdingOwnerCount());
+}
+
+void setUp(){
+	fakeOutputClear();
+	benchKeyDown = false;
+	benchRaw = stableState;
+}
+
+void tearDown(){
+}
+
+static void bench_input_path(){
+	printf("=== Host input benchmarks (ns per call) ===\n");
+	printf("%-24s %8s %8s %8s %8s\n", "benchmark", "iters", "min", "avg", "max");
+	printRow("empty call", benchEmpty);
+	printRow("debounce (steady)", benchDebounceSteady);
+	printRow("debounce (bouncing)", benchDebounceBouncing);
+	printRow("flipper press/release", benchFlipperEdge);
+	printRow("nudge start/end", benchNudge);
+	printRow("axis flush (3 axes)", benchAxisFlush);
+}
+
+int main(){
+	currentGameMode = QUEST_PINBALL_FX_VR;
+	selectGameProfile(QUEST_PINBALL_FX_VR);
+	// Drain once so the nudge subscription exists before the first nudge is published
+	updateButtonStates(stableState, millis());
+	UNITY_BEGIN();
+	RUN_TEST(bench_input_path);
+	return UNITY_END();
+}
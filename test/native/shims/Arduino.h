@@ -0,0 +1,70 @@
+#pragma once
+
+// Just enough of the Arduino core for the modules env:native builds (see build_src_filter in
+// platformio.ini). Time only moves when a test moves it
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IRAM_ATTR
+
+// One task, so the critical sections have nothing to exclude
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED   0
+#define portENTER_CRITICAL(mux)        ((void)(mux))
+#define portEXIT_CRITICAL(mux)         ((void)(mux))
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0
+#define OUTPUT  1
+
+inline unsigned long& nativeMicros(){
+	static unsigned long now = 0;
+	return now;
+}
+
+inline unsigned long micros(){
+	return nativeMicros();
+}
+
+inline unsigned long millis(){
+	return nativeMicros() / 1000;
+}
+
+inline void delayMicroseconds(unsigned int){
+}
+
+inline void pinMode(uint8_t, uint8_t){
+}
+
+inline void digitalWrite(uint8_t, uint8_t){
+}
+
+inline int digitalRead(uint8_t){
+	return LOW;
+}
+
+class NativeSerial {
+public:
+	template <typename... Args> int printf(const char* format, Args... args){
+		return ::printf(format, args...);
+	}
+	int print(const char* text){
+		return ::printf("%s", text);
+	}
+	int print(int value){
+		return ::printf("%d", value);
+	}
+	int println(const char* text = ""){
+		return ::printf("%s\n", text);
+	}
+	int println(int value){
+		return ::printf("%d\n", value);
+	}
+};
+
+// Stateless, so each translation unit having its own copy is harmless
+static NativeSerial Serial __attribute__((unused));
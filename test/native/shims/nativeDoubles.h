@@ -0,0 +1,38 @@
+#pragma once
+
+// The modules env:native builds reach into the settings store, main.cpp and the task manager,
+// which it leaves out. Include this from exactly one file per test suite
+#include "preferencesManager.hpp"
+#include "taskManager.hpp"
+#include "analogInputs.hpp"
+
+// All zero: no debounce, no axis epsilon or refresh, and the hold limits are off
+int32_t settingValues[NUM_SETTINGS];
+
+int currentGameMode = 0;
+
+// No flash: nothing saved, so every mode runs its built-in map
+bool loadSettingsBlob(const char* key, void* data, size_t length){
+	return false;
+}
+
+void saveSettingsBlob(const char* key, const void* data, size_t length){
+}
+
+void eraseSettingsBlob(const char* key){
+}
+
+void saveControllerMode(int mode){
+}
+
+// Stands in for the filtered ADC reading; set by the tests
+uint16_t nativeAnalogPositions[NUM_ANALOG_INPUTS];
+
+uint16_t analogPosition(uint8_t input){
+	return nativeAnalogPositions[input];
+}
+
+// There is only one task here, as before startTasks() on the board
+void runOnInputTask(void (*job)(const char* args), const char* args){
+	job(args);
+}
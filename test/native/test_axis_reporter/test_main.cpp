@@ -0,0 +1,185 @@
+#include <unity.h>
+#include "axisReporter.hpp"
+#include "hidOutput.hpp"
+#include "nativeDoubles.h"
+
+#define EPSILON             4
+#define REFRESH_MS          50
+#define REPORT_INTERVAL_US  7500     // a typical BLE connection interval
+
+void setUp(){
+	settingValues[SETTING_AXIS_EPSILON] = EPSILON;
+	settingValues[SETTING_AXIS_REFRESH_MS] = REFRESH_MS;
+	fakeOutputSetReportInterval(0);
+	resetAxisReports();
+	// Well past the last flush of the previous test, so its report interval is over
+	nativeMicros() += 1000000;
+	fakeOutputClear();
+}
+
+void tearDown(){
+}
+
+static void advanceUs(unsigned long us){
+	nativeMicros() += us;
+}
+
+// Sets the axis, flushes, and clears the log
+static void sendAxis(uint8_t axis, int8_t value){
+	reportAxis(axis, value);
+	flushAxisReports();
+	fakeOutputClear();
+}
+
+static void assertAxisSent(uint8_t axis, int8_t value){
+	uint8_t count;
+	const FakeOutputEvent* log = fakeOutputLog(&count);
+	TEST_ASSERT_EQUAL_UINT8(1, fakeOutputAxisReports());
+	TEST_ASSERT_EQUAL_UINT8(1, count);
+	TEST_ASSERT_EQUAL_UINT8(FAKE_PAD_AXIS, log[0].type);
+	TEST_ASSERT_EQUAL_UINT8(axis, log[0].code);
+	TEST_ASSERT_EQUAL_INT8(value, log[0].value);
+	fakeOutputClear();
+}
+
+static void assertNothingSent(){
+	uint8_t count;
+	fakeOutputLog(&count);
+	TEST_ASSERT_EQUAL_UINT8(0, fakeOutputAxisReports());
+	TEST_ASSERT_EQUAL_UINT8(0, count);
+}
+
+static void test_first_value_goes_out_at_once(){
+	reportAxis(PAD_AXIS_Z, 1);
+	flushAxisReports();
+	assertAxisSent(PAD_AXIS_Z, 1);
+}
+
+static void test_moves_below_epsilon_wait(){
+	sendAxis(PAD_AXIS_Z, 10);
+
+	reportAxis(PAD_AXIS_Z, 10 + EPSILON - 1);
+	flushAxisReports();
+	assertNothingSent();
+
+	// Measured against what was sent, not the previous tick, so a slow drift still gets out
+	reportAxis(PAD_AXIS_Z, 10 + EPSILON);
+	flushAxisReports();
+	assertAxisSent(PAD_AXIS_Z, 10 + EPSILON);
+
+	// Same value again is never due
+	advanceUs(REFRESH_MS * 1000UL);
+	flushAxisReports();
+	assertNothingSent();
+}
+
+static void test_range_ends_skip_epsilon(){
+	sendAxis(PAD_AXIS_LEFT_TRIGGER, 126);
+	reportAxis(PAD_AXIS_LEFT_TRIGGER, 127);
+	flushAxisReports();
+	assertAxisSent(PAD_AXIS_LEFT_TRIGGER, 127);
+
+	sendAxis(PAD_AXIS_LEFT_TRIGGER, -125);
+	reportAxis(PAD_AXIS_LEFT_TRIGGER, -127);
+	flushAxisReports();
+	assertAxisSent(PAD_AXIS_LEFT_TRIGGER, -127);
+}
+
+static void test_small_move_goes_out_after_refresh(){
+	sendAxis(PAD_AXIS_Z, 20);
+
+	reportAxis(PAD_AXIS_Z, 21);
+	advanceUs(REFRESH_MS * 1000UL - 1);
+	flushAxisReports();
+	assertNothingSent();
+
+	advanceUs(1);
+	flushAxisReports();
+	assertAxisSent(PAD_AXIS_Z, 21);
+
+	// The refresh time starts over from that report
+	reportAxis(PAD_AXIS_Z, 22);
+	advanceUs(REFRESH_MS * 1000UL - 1);
+	flushAxisReports();
+	assertNothingSent();
+}
+
+static void test_due_axes_wait_for_report_interval(){
+	fakeOutputSetReportInterval(REPORT_INTERVAL_US);
+	sendAxis(PAD_AXIS_Z, 0);
+
+	// Due, but the link can't take another report yet
+	advanceUs(1000);
+	reportAxis(PAD_AXIS_Z, 60);
+	flushAxisReports();
+	assertNothingSent();
+
+	// Held until the interval is over, then the latest value goes, not the first held one
+	advanceUs(REPORT_INTERVAL_US - 1000 - 1);
+	reportAxis(PAD_AXIS_Z, 70);
+	flushAxisReports();
+	assertNothingSent();
+
+	advanceUs(1);
+	flushAxisReports();
+	assertAxisSent(PAD_AXIS_Z, 70);
+}
+
+static void test_changed_axes_share_one_report(){
+	reportAxis(PAD_AXIS_Z, -50);
+	reportAxis(PAD_AXIS_LEFT_TRIGGER, 30);
+	reportAxis(PAD_AXIS_RIGHT_TRIGGER, 90);
+	flushAxisReports();
+
+	uint8_t count;
+	const FakeOutputEvent* log = fakeOutputLog(&count);
+	TEST_ASSERT_EQUAL_UINT8(1, fakeOutputAxisReports());
+	TEST_ASSERT_EQUAL_UINT8(3, count);
+	TEST_ASSERT_EQUAL_UINT8(PAD_AXIS_Z, log[0].code);
+	TEST_ASSERT_EQUAL_INT8(-50, log[0].value);
+	TEST_ASSERT_EQUAL_UINT8(PAD_AXIS_LEFT_TRIGGER, log[1].code);
+	TEST_ASSERT_EQUAL_INT8(30, log[1].value);
+	TEST_ASSERT_EQUAL_UINT8(PAD_AXIS_RIGHT_TRIGGER, log[2].code);
+	TEST_ASSERT_EQUAL_INT8(90, log[2].value);
+}
+
+static void test_axes_held_by_interval_go_out_together(){
+	fakeOutputSetReportInterval(REPORT_INTERVAL_US);
+	reportAxis(PAD_AXIS_Z, 0);
+	reportAxis(PAD_AXIS_LEFT_TRIGGER, 0);
+	reportAxis(PAD_AXIS_RIGHT_TRIGGER, 0);
+	flushAxisReports();
+	fakeOutputClear();
+
+	// Due on different ticks inside one interval; the trigger that stayed put is not resent
+	advanceUs(2000);
+	reportAxis(PAD_AXIS_Z, 40);
+	flushAxisReports();
+	advanceUs(2000);
+	reportAxis(PAD_AXIS_LEFT_TRIGGER, 100);
+	flushAxisReports();
+	assertNothingSent();
+
+	advanceUs(REPORT_INTERVAL_US - 4000);
+	flushAxisReports();
+	uint8_t count;
+	const FakeOutputEvent* log = fakeOutputLog(&count);
+	TEST_ASSERT_EQUAL_UINT8(1, fakeOutputAxisReports());
+	TEST_ASSERT_EQUAL_UINT8(2, count);
+	TEST_ASSERT_EQUAL_UINT8(PAD_AXIS_Z, log[0].code);
+	TEST_ASSERT_EQUAL_INT8(40, log[0].value);
+	TEST_ASSERT_EQUAL_UINT8(PAD_AXIS_LEFT_TRIGGER, log[1].code);
+	TEST_ASSERT_EQUAL_INT8(100, log[1].value);
+}
+
+int main(){
+	UNITY_BEGIN();
+	RUN_TEST(test_first_value_goes_out_at_once);
+	RUN_TEST(test_moves_below_epsilon_wait);
+	RUN_TEST(test_range_ends_skip_epsilon);
+	RUN_TEST(test_small_move_goes_out_after_refresh);
+	RUN_TEST(test_due_axes_wait_for_report_interval);
+	RUN_TEST(test_changed_axes_share_one_report);
+	RUN_TEST(test_axes_held_by_interval_go_out_together);
+	return UNITY_END();
+}
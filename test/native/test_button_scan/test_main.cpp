@@ -0,0 +1,149 @@
+#include <unity.h>
+#include "arcadeButtonProcessor.hpp"
+#include "gameProfiles.hpp"
+#include "keyArbiter.hpp"
+#include "safetySupervisor.hpp"
+#include "eventBus.hpp"
+#include "hidOutput.hpp"
+#include "nativeDoubles.h"
+
+// Quest Pinball FX VR nudges sideways on the MagnaSave keys, so a nudge and a MagnaSave can hold
+// the same key at once
+#define NUDGE_LEFT_KEY      KEY_LMAGNASAVE_QPVR
+
+static InputWord pressedBit(uint8_t bit){
+	return INPUT_BIT(bit);
+}
+
+// One input task step, as in main.cpp: the supervisor first, then a scan while the link is up.
+// Each step is a millisecond
+static void step(InputWord pressed){
+	nativeMicros() += 1000;
+	bool linked = outputConnected();
+	serviceSafety(linked);
+	if (linked) updateButtonStates(~pressed, millis());
+}
+
+// What the accelerometer publishes on the other core; drained by the next scan
+static void nudge(uint8_t key, bool started){
+	publishEvent(EVENT_NUDGE, key, started);
+}
+
+static void assertEvents(const FakeOutputEvent* expected, uint8_t expectedCount){
+	uint8_t count;
+	const FakeOutputEvent* log = fakeOutputLog(&count);
+	TEST_ASSERT_EQUAL_UINT8(expectedCount, count);
+	for (uint8_t i = 0; i < expectedCount; i++) {
+		TEST_ASSERT_EQUAL_UINT8(expected[i].type, log[i].type);
+		TEST_ASSERT_EQUAL_UINT8(expected[i].code, log[i].code);
+	}
+	fakeOutputClear();
+}
+
+static void assertOnly(uint8_t type, uint8_t code){
+	const FakeOutputEvent expected[] = {{type, code, 0}};
+	assertEvents(expected, 1);
+}
+
+static void assertNothing(){
+	assertEvents(nullptr, 0);
+}
+
+void setUp(){
+	fakeOutputSetConnected(true);
+	forceReleaseAll(RELEASE_MODE_CHANGE);
+	resetButtonStates();
+	// Settles the debounced state and drains any nudge left over from the last test
+	step(0);
+	fakeOutputClear();
+}
+
+void tearDown(){
+}
+
+static void test_nudge_magnasave_and_flipper_in_one_scan(){
+	nudge(NUDGE_LEFT_KEY, true);
+	step(pressedBit(BTN_BIT_LMAGNASAVE) | pressedBit(BTN_BIT_LFLIPPER));
+	// The nudge drains first; the MagnaSave only becomes a second owner of its key
+	const FakeOutputEvent pressed[] = {
+		{FAKE_KEY_PRESS, NUDGE_LEFT_KEY, 0},
+		{FAKE_KEY_PRESS, KEY_LFLIPPER_QPVR, 0}
+	};
+	assertEvents(pressed, 2);
+	TEST_ASSERT_TRUE(coilEnergized(COIL_LEFT));
+
+	nudge(NUDGE_LEFT_KEY, false);
+	step(pressedBit(BTN_BIT_LMAGNASAVE) | pressedBit(BTN_BIT_LFLIPPER));
+	assertNothing();
+
+	step(pressedBit(BTN_BIT_LFLIPPER));
+	assertOnly(FAKE_KEY_RELEASE, NUDGE_LEFT_KEY);
+	step(0);
+	assertOnly(FAKE_KEY_RELEASE, KEY_LFLIPPER_QPVR);
+	TEST_ASSERT_FALSE(coilEnergized(COIL_LEFT));
+}
+
+static void test_release_during_nudge(){
+	step(pressedBit(BTN_BIT_LMAGNASAVE));
+	assertOnly(FAKE_KEY_PRESS, NUDGE_LEFT_KEY);
+	nudge(NUDGE_LEFT_KEY, true);
+	step(pressedBit(BTN_BIT_LMAGNASAVE));
+	assertNothing();
+
+	// Letting go of the MagnaSave mid-nudge leaves the key to the nudge
+	step(0);
+	assertNothing();
+	nudge(NUDGE_LEFT_KEY, false);
+	step(0);
+	assertOnly(FAKE_KEY_RELEASE, NUDGE_LEFT_KEY);
+
+	// And the other way round: a MagnaSave pressed and released inside a nudge sends nothing
+	nudge(NUDGE_LEFT_KEY, true);
+	step(0);
+	assertOnly(FAKE_KEY_PRESS, NUDGE_LEFT_KEY);
+	step(pressedBit(BTN_BIT_LMAGNASAVE));
+	step(0);
+	assertNothing();
+	nudge(NUDGE_LEFT_KEY, false);
+	step(0);
+	assertOnly(FAKE_KEY_RELEASE, NUDGE_LEFT_KEY);
+}
+
+static void test_disconnect_while_keys_held(){
+	nudge(NUDGE_LEFT_KEY, true);
+	step(pressedBit(BTN_BIT_RMAGNASAVE) | pressedBit(BTN_BIT_LFLIPPER));
+	const FakeOutputEvent pressed[] = {
+		{FAKE_KEY_PRESS, NUDGE_LEFT_KEY, 0},
+		{FAKE_KEY_PRESS, KEY_RMAGNASAVE_QPVR, 0},
+		{FAKE_KEY_PRESS, KEY_LFLIPPER_QPVR, 0}
+	};
+	assertEvents(pressed, 3);
+
+	fakeOutputSetConnected(false);
+	step(pressedBit(BTN_BIT_RMAGNASAVE) | pressedBit(BTN_BIT_LFLIPPER));
+	assertOnly(FAKE_RELEASE_ALL, 0);
+	TEST_ASSERT_EQUAL_UINT8(0, holdingOwnerCount());
+	TEST_ASSERT_FALSE(coilEnergized(COIL_LEFT));
+
+	// The MagnaSave and the nudge end while the link is down; nothing is scanned meanwhile
+	nudge(NUDGE_LEFT_KEY, false);
+	step(pressedBit(BTN_BIT_LFLIPPER));
+	assertNothing();
+
+	// Back up with the flipper still held: it is pressed again, the stale nudge end sends nothing
+	fakeOutputSetConnected(true);
+	step(pressedBit(BTN_BIT_LFLIPPER));
+	assertOnly(FAKE_KEY_PRESS, KEY_LFLIPPER_QPVR);
+	TEST_ASSERT_TRUE(coilEnergized(COIL_LEFT));
+	step(0);
+	assertOnly(FAKE_KEY_RELEASE, KEY_LFLIPPER_QPVR);
+}
+
+int main(){
+	selectGameProfile(QUEST_PINBALL_FX_VR);
+	UNITY_BEGIN();
+	RUN_TEST(test_nudge_magnasave_and_flipper_in_one_scan);
+	RUN_TEST(test_release_during_nudge);
+	RUN_TEST(test_disconnect_while_keys_held);
+	return UNITY_END();
+}
@@ -0,0 +1,187 @@
+#include <unity.h>
+#include "arcadeButtonProcessor.hpp"
+#include "gameProfiles.hpp"
+#include "analogPlunger.hpp"
+#include "axisReporter.hpp"
+#include "keyArbiter.hpp"
+#include "safetySupervisor.hpp"
+#include "hidOutput.hpp"
+#include "nativeDoubles.h"
+
+#define FULL_PULL           800      // position units, 0..ANALOG_FULL_SCALE
+#define FULL_PULL_HOLD_MS   (FULL_PULL * PLUNGER_FULL_PULL_MS / ANALOG_FULL_SCALE)
+
+static InputWord pressedBits = 0;
+
+// One input task step, as in main.cpp: the supervisor, the plunger, then the scan. Each step is a
+// millisecond
+static void step(){
+	nativeMicros() += 1000;
+	bool linked = outputConnected();
+	serviceSafety(linked);
+	if (!linked) return;
+	servicePlunger(millis());
+	updateButtonStates(~pressedBits, millis());
+}
+
+static void steps(uint32_t count){
+	while (count--) step();
+}
+
+static void setPressed(uint8_t bit, bool pressed){
+	if (pressed) pressedBits |= INPUT_BIT(bit);
+	else pressedBits &= ~INPUT_BIT(bit);
+	step();
+}
+
+static void useProfile(int mode){
+	currentGameMode = mode;
+	selectGameProfile(mode);
+}
+
+// Pulls the plunger back over a few ticks, holds it, and lets go
+static void launchPlunger(uint16_t pull){
+	for (uint8_t tick = 1; tick <= 4; tick++) {
+		nativeAnalogPositions[ANALOG_IN_PLUNGER] = pull * tick / 4;
+		step();
+	}
+	steps(20);
+	nativeAnalogPositions[ANALOG_IN_PLUNGER] = 0;
+	step();
+}
+
+static void assertEvents(const FakeOutputEvent* expected, uint8_t expectedCount){
+	uint8_t count;
+	const FakeOutputEvent* log = fakeOutputLog(&count);
+	TEST_ASSERT_EQUAL_UINT8(expectedCount, count);
+	for (uint8_t i = 0; i < expectedCount; i++) {
+		TEST_ASSERT_EQUAL_UINT8(expected[i].type, log[i].type);
+		TEST_ASSERT_EQUAL_UINT8(expected[i].code, log[i].code);
+		TEST_ASSERT_EQUAL_INT8(expected[i].value, log[i].value);
+	}
+	fakeOutputClear();
+}
+
+static void assertOnly(uint8_t type, uint8_t code){
+	const FakeOutputEvent expected[] = {{type, code, 0}};
+	assertEvents(expected, 1);
+}
+
+static void assertNothing(){
+	assertEvents(nullptr, 0);
+}
+
+void setUp(){
+	memset(settingValues, 0, sizeof(settingValues));
+	settingValues[SETTING_PLUNGER_MODE] = PLUNGER_KEYS;
+	memset(nativeAnalogPositions, 0, sizeof(nativeAnalogPositions));
+	fakeOutputSetConnected(true);
+	forceReleaseAll(RELEASE_MODE_CHANGE);
+	resetButtonStates();
+	pressedBits = 0;
+	useProfile(PC_VISUAL_PINBALL);
+	// Lets the plunger settle and any key it held go up
+	steps(PLUNGER_FULL_PULL_MS);
+	fakeOutputClear();
+}
+
+void tearDown(){
+}
+
+static void test_flipper_press_and_release_reports(){
+	setPressed(BTN_BIT_LFLIPPER, true);
+	assertOnly(FAKE_KEY_PRESS, KEY_LFLIPPER_PCVP);
+	TEST_ASSERT_TRUE(coilEnergized(COIL_LEFT));
+	steps(10);
+	assertNothing();
+	setPressed(BTN_BIT_LFLIPPER, false);
+	assertOnly(FAKE_KEY_RELEASE, KEY_LFLIPPER_PCVP);
+	TEST_ASSERT_FALSE(coilEnergized(COIL_LEFT));
+}
+
+static void test_pad_action_reports_gamepad_button(){
+	mapCommand("7 pad 3");
+	setPressed(BTN_BIT_LFLIPPER, true);
+	assertOnly(FAKE_PAD_PRESS, 3);
+	setPressed(BTN_BIT_LFLIPPER, false);
+	assertOnly(FAKE_PAD_RELEASE, 3);
+}
+
+static void test_keyboard_profile_refuses_pad_action(){
+	useProfile(QUEST_PINBALL_FX_VR);
+	mapCommand("7 pad 3");
+	setPressed(BTN_BIT_LFLIPPER, true);
+	assertOnly(FAKE_KEY_PRESS, KEY_LFLIPPER_QPVR);
+}
+
+static void test_key_hold_limit_releases_stuck_key(){
+	settingValues[SETTING_KEY_HOLD_LIMIT_S] = 1;
+	setPressed(BTN_BIT_START, true);
+	assertOnly(FAKE_KEY_PRESS, KEY_START_PCVP);
+	steps(499);
+	setPressed(BTN_BIT_RFLIPPER, true);
+	assertOnly(FAKE_KEY_PRESS, KEY_RFLIPPER_PCVP);
+	steps(499);
+	assertNothing();
+
+	// Only the key held past the limit goes up, and it stays up while the button is held
+	step();
+	assertOnly(FAKE_KEY_RELEASE, KEY_START_PCVP);
+	steps(10);
+	assertNothing();
+	setPressed(BTN_BIT_START, false);
+	assertNothing();
+	setPressed(BTN_BIT_RFLIPPER, false);
+	assertOnly(FAKE_KEY_RELEASE, KEY_RFLIPPER_PCVP);
+}
+
+static void test_mode_switch_releases_held_keys(){
+	setPressed(BTN_BIT_LFLIPPER, true);
+	assertOnly(FAKE_KEY_PRESS, KEY_LFLIPPER_PCVP);
+
+	switchControllerMode(QUEST_PINBALL_FX_VR);
+	assertOnly(FAKE_RELEASE_ALL, 0);
+	// The flipper is still down, so the next scan presses it under the new map
+	step();
+	assertOnly(FAKE_KEY_PRESS, KEY_LFLIPPER_QPVR);
+}
+
+static void test_plunger_launch_holds_key_for_its_strength(){
+	launchPlunger(FULL_PULL);
+	assertOnly(FAKE_KEY_PRESS, KEY_PLUNGER_PCVP);
+	steps(FULL_PULL_HOLD_MS - 1);
+	assertNothing();
+	step();
+	assertOnly(FAKE_KEY_RELEASE, KEY_PLUNGER_PCVP);
+}
+
+static void test_plunger_axis_mode_reports_z(){
+	settingValues[SETTING_PLUNGER_MODE] = PLUNGER_AXIS;
+	nativeAnalogPositions[ANALOG_IN_PLUNGER] = ANALOG_FULL_SCALE;
+	servicePlunger(millis());
+	flushAxisReports();
+	const FakeOutputEvent expected[] = {{FAKE_PAD_AXIS, PAD_AXIS_Z, 127}};
+	assertEvents(expected, 1);
+}
+
+static void test_plunger_axis_mode_uses_keys_on_keyboard_profile(){
+	useProfile(QUEST_PINBALL_FX_VR);
+	settingValues[SETTING_PLUNGER_MODE] = PLUNGER_AXIS;
+	launchPlunger(FULL_PULL);
+	assertOnly(FAKE_KEY_PRESS, KEY_PLUNGER_QPVR);
+	steps(FULL_PULL_HOLD_MS);
+	assertOnly(FAKE_KEY_RELEASE, KEY_PLUNGER_QPVR);
+}
+
+int main(){
+	UNITY_BEGIN();
+	RUN_TEST(test_flipper_press_and_release_reports);
+	RUN_TEST(test_pad_action_reports_gamepad_button);
+	RUN_TEST(test_keyboard_profile_refuses_pad_action);
+	RUN_TEST(test_key_hold_limit_releases_stuck_key);
+	RUN_TEST(test_mode_switch_releases_held_keys);
+	RUN_TEST(test_plunger_launch_holds_key_for_its_strength);
+	RUN_TEST(test_plunger_axis_mode_reports_z);
+	RUN_TEST(test_plunger_axis_mode_uses_keys_on_keyboard_profile);
+	return UNITY_END();
+}
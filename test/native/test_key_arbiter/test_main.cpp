@@ -0,0 +1,142 @@
+#include <unity.h>
+#include "keyArbiter.hpp"
+#include "safetySupervisor.hpp"
+#include "hidOutput.hpp"
+#include "nativeDoubles.h"
+
+#define BUTTON_OWNER    0    // input bit 0, e.g. a MagnaSave on the nudge key
+#define OTHER_BUTTON    1
+#define SHARED_KEY      KEY_LEFT_SHIFT
+
+void setUp(){
+	releaseAllKeys();
+	fakeOutputClear();
+}
+
+void tearDown(){
+}
+
+// Events since the last clear
+static uint8_t takeEvents(const FakeOutputEvent** log){
+	uint8_t count;
+	*log = fakeOutputLog(&count);
+	return count;
+}
+
+static void assertOnly(uint8_t type, uint8_t code){
+	const FakeOutputEvent* log;
+	uint8_t count = takeEvents(&log);
+	TEST_ASSERT_EQUAL_UINT8(1, count);
+	TEST_ASSERT_EQUAL_UINT8(type, log[0].type);
+	TEST_ASSERT_EQUAL_UINT8(code, log[0].code);
+	fakeOutputClear();
+}
+
+static void assertNothing(){
+	const FakeOutputEvent* log;
+	TEST_ASSERT_EQUAL_UINT8(0, takeEvents(&log));
+}
+
+static void test_overlapping_owners_hold_until_last_release(){
+	pressKey(BUTTON_OWNER, SHARED_KEY);
+	assertOnly(FAKE_KEY_PRESS, SHARED_KEY);
+	pressKey(KEY_OWNER_NUDGE, SHARED_KEY);
+	assertNothing();
+
+	releaseKey(BUTTON_OWNER, SHARED_KEY);
+	assertNothing();
+	releaseKey(KEY_OWNER_NUDGE, SHARED_KEY);
+	assertOnly(FAKE_KEY_RELEASE, SHARED_KEY);
+}
+
+static void test_overlap_released_in_press_order(){
+	pressKey(KEY_OWNER_NUDGE, SHARED_KEY);
+	pressKey(BUTTON_OWNER, SHARED_KEY);
+	assertOnly(FAKE_KEY_PRESS, SHARED_KEY);
+
+	releaseKey(KEY_OWNER_NUDGE, SHARED_KEY);
+	assertNothing();
+	releaseKey(BUTTON_OWNER, SHARED_KEY);
+	assertOnly(FAKE_KEY_RELEASE, SHARED_KEY);
+}
+
+static void test_double_release_does_not_go_negative(){
+	pressKey(BUTTON_OWNER, SHARED_KEY);
+	releaseKey(BUTTON_OWNER, SHARED_KEY);
+	fakeOutputClear();
+
+	releaseKey(BUTTON_OWNER, SHARED_KEY);
+	releaseKey(KEY_OWNER_NUDGE, SHARED_KEY);
+	assertNothing();
+
+	// A count left below zero would swallow this press
+	pressKey(KEY_OWNER_NUDGE, SHARED_KEY);
+	assertOnly(FAKE_KEY_PRESS, SHARED_KEY);
+	releaseKey(KEY_OWNER_NUDGE, SHARED_KEY);
+	assertOnly(FAKE_KEY_RELEASE, SHARED_KEY);
+}
+
+static void test_double_press_needs_one_release(){
+	pressKey(BUTTON_OWNER, SHARED_KEY);
+	pressKey(BUTTON_OWNER, SHARED_KEY);
+	assertOnly(FAKE_KEY_PRESS, SHARED_KEY);
+
+	releaseKey(BUTTON_OWNER, SHARED_KEY);
+	assertOnly(FAKE_KEY_RELEASE, SHARED_KEY);
+}
+
+static void test_double_pad_release_does_not_go_negative(){
+	pressPadButton(BUTTON_OWNER, 5);
+	releasePadButton(BUTTON_OWNER, 5);
+	releasePadButton(BUTTON_OWNER, 5);
+	fakeOutputClear();
+
+	pressPadButton(OTHER_BUTTON, 5);
+	assertOnly(FAKE_PAD_PRESS, 5);
+}
+
+static void test_force_release_all_clears_every_owner(){
+	pressKey(BUTTON_OWNER, SHARED_KEY);
+	pressKey(KEY_OWNER_NUDGE, SHARED_KEY);
+	pressKey(KEY_OWNER_PLUNGER, KEY_RETURN);
+	pressPadButton(OTHER_BUTTON, 2);
+	TEST_ASSERT_EQUAL_UINT8(4, holdingOwnerCount());
+	fakeOutputClear();
+
+	forceReleaseAll(RELEASE_DISCONNECT);
+	TEST_ASSERT_EQUAL_UINT8(0, holdingOwnerCount());
+	TEST_ASSERT_FALSE(ownerHolding(BUTTON_OWNER));
+	TEST_ASSERT_FALSE(ownerHolding(OTHER_BUTTON));
+	TEST_ASSERT_FALSE(ownerHolding(KEY_OWNER_NUDGE));
+	TEST_ASSERT_FALSE(ownerHolding(KEY_OWNER_PLUNGER));
+	// Gamepad buttons go up one by one, then the empty keyboard report
+	const FakeOutputEvent* log;
+	TEST_ASSERT_EQUAL_UINT8(2, takeEvents(&log));
+	TEST_ASSERT_EQUAL_UINT8(FAKE_PAD_RELEASE, log[0].type);
+	TEST_ASSERT_EQUAL_UINT8(2, log[0].code);
+	TEST_ASSERT_EQUAL_UINT8(FAKE_RELEASE_ALL, log[1].type);
+	fakeOutputClear();
+
+	// Stale releases from the old owners send nothing, and the counts start from zero again
+	releaseKey(BUTTON_OWNER, SHARED_KEY);
+	releaseKey(KEY_OWNER_NUDGE, SHARED_KEY);
+	releasePadButton(OTHER_BUTTON, 2);
+	assertNothing();
+	pressKey(KEY_OWNER_NUDGE, SHARED_KEY);
+	assertOnly(FAKE_KEY_PRESS, SHARED_KEY);
+	releaseKey(KEY_OWNER_NUDGE, SHARED_KEY);
+	assertOnly(FAKE_KEY_RELEASE, SHARED_KEY);
+	pressPadButton(BUTTON_OWNER, 2);
+	assertOnly(FAKE_PAD_PRESS, 2);
+}
+
+int main(){
+	UNITY_BEGIN();
+	RUN_TEST(test_overlapping_owners_hold_until_last_release);
+	RUN_TEST(test_overlap_released_in_press_order);
+	RUN_TEST(test_double_release_does_not_go_negative);
+	RUN_TEST(test_double_press_needs_one_release);
+	RUN_TEST(test_double_pad_release_does_not_go_negative);
+	RUN_TEST(test_force_release_all_clears_every_owner);
+	return UNITY_END();
+}
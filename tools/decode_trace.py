@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Decode a pinballWizard trace dump (see src/traceRecorder.cpp) into CSV.
+
+Capture the dump with any serial logger while sending "trace dump", e.g.
+    python3 decode_trace.py capture.bin > trace.csv
+or read straight from the port (needs pyserial):
+    python3 decode_trace.py --port COM3 > trace.csv
+"""
+import argparse
+import struct
+import sys
+
+MAGIC = b"PWTR"
+FORMAT_VERSION = 1
+
+TRACE_RAW_INPUT = 1
+TRACE_ACCEL = 2
+TRACE_HID_PRESS = 3
+TRACE_HID_RELEASE = 4
+
+
+def read_varint(data, pos):
+	value = 0
+	shift = 0
+	while True:
+		byte = data[pos]
+		pos += 1
+		value |= (byte & 0x7F) << shift
+		if byte < 0x80:
+			return value, pos
+		shift += 7
+
+
+def unzigzag(value):
+	return (value >> 1) ^ -(value & 1)
+
+
+def decode(data, out):
+	start = data.find(MAGIC)
+	if start < 0:
+		sys.exit("no trace header found")
+	version, block_count, block_size, dropped = struct.unpack_from("<BHHI", data, start + 4)
+	if version != FORMAT_VERSION:
+		sys.exit("unsupported trace version %d" % version)
+	out.write("# blocks=%d block_size=%d dropped_blocks=%d\n" % (block_count, block_size, dropped))
+	out.write("time_us,event,a,b,c\n")
+
+	pos = start + 13
+	epoch = None
+	last_start = 0
+	wraps = 0
+	for _ in range(block_count):
+		block_start, used = struct.unpack_from("<IH", data, pos)
+		pos += 6
+		end = pos + used
+		# micros() wraps every ~71 minutes; keep timestamps monotonic
+		if block_start < last_start:
+			wraps += 1
+		last_start = block_start
+		now = block_start + (wraps << 32)
+		if epoch is None:
+			epoch = now
+		accel = [0, 0, 0]
+		while pos < end:
+			kind = data[pos]
+			delta, pos = read_varint(data, pos + 1)
+			now += delta
+			t = now - epoch
+			if kind == TRACE_RAW_INPUT:
+				raw, pos = read_varint(data, pos)
+				out.write("%d,raw,0x%02X,,\n" % (t, raw))
+			elif kind == TRACE_ACCEL:
+				for axis in range(3):
+					value, pos = read_varint(data, pos)
+					accel[axis] += unzigzag(value)
+				out.write("%d,accel,%d,%d,%d\n" % (t, accel[0], accel[1], accel[2]))
+			elif kind in (TRACE_HID_PRESS, TRACE_HID_RELEASE):
+				key = data[pos]
+				pos += 1
+				action = "press" if kind == TRACE_HID_PRESS else "release"
+				out.write("%d,%s,0x%02X,,\n" % (t, action, key))
+			else:
+				sys.exit("corrupt record type %d at offset %d" % (kind, pos))
+
+
+def read_port(port, baud):
+	import serial
+	with serial.Serial(port, baud, timeout=2) as link:
+		link.reset_input_buffer()
+		link.write(b"trace dump\n")
+		data = bytearray()
+		while True:
+			chunk = link.read(4096)
+			if not chunk:
+				return bytes(data)
+			data += chunk
+
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+	parser.add_argument("capture", nargs="?", help="raw serial capture containing a trace dump")
+	parser.add_argument("--port", help="serial port to request the dump from")
+	parser.add_argument("--baud", type=int, default=115200)
+	args = parser.parse_args()
+
+	if args.port:
+		data = read_port(args.port, args.baud)
+	elif args.capture:
+		with open(args.capture, "rb") as f:
+			data = f.read()
+	else:
+		parser.error("give a capture file or --port")
+	decode(data, sys.stdout)
+
+
+if __name__ == "__main__":
+	main()